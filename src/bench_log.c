@@ -0,0 +1,57 @@
+#include "log.h"
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * lime-bench-log: per call cost of lime_info with the message written,
+ * filtered at runtime and compiled out, the written case appends to lime.log
+ * in the working directory like lime itself
+ */
+
+void lime_bench_log_off(const char *name, int count);
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void log_calls(const char *name, int count) {
+  for (int i = 0; i < count; i++) {
+    lime_info("event: %s %d", name, i);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 2000000;
+  if (count <= 0) {
+    fprintf(stderr, "usage: %s [calls]\n", argv[0]);
+    return 1;
+  }
+  // the ring holds 4096 records, more than that measures the drop path
+  int written = count < 4096 ? count : 4096;
+
+  lime_log_set_level(LIME_LOG_INFO);
+  // the first call starts the writer thread
+  log_calls("warm up", 1);
+  double start = now_ns();
+  log_calls("MotionNotify", written);
+  double end = now_ns();
+  printf("written:         %8.1f ns/call (%d calls)\n",
+         (end - start) / written, written);
+  lime_log_close();
+
+  lime_log_set_level(LIME_LOG_ERROR);
+  start = now_ns();
+  log_calls("MotionNotify", count);
+  end = now_ns();
+  printf("runtime filtered: %7.1f ns/call (%d calls)\n", (end - start) / count,
+         count);
+
+  start = now_ns();
+  lime_bench_log_off("MotionNotify", count);
+  end = now_ns();
+  printf("compiled out:    %8.1f ns/call (%d calls)\n", (end - start) / count,
+         count);
+  return 0;
+}
@@ -0,0 +1,11 @@
+#include "log.h"
+
+/*
+ * built with LIME_LOG_COMPILE_LEVEL=LIME_LOG_NONE for lime-bench-log, the
+ * lime_info below is compiled out
+ */
+void lime_bench_log_off(const char *name, int count) {
+  for (int i = 0; i < count; i++) {
+    lime_info("event: %s %d", name, i);
+  }
+}
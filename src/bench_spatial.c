@@ -0,0 +1,139 @@
+#include "mem.h"
+#include "spatial.h"
+#include <time.h>
+
+/*
+ * lime-bench-spatial: point query cost of the spatial index against a linear
+ * scan of the geometry store at 10, 100 and 1000 frames, and the cost of
+ * reindexing a frame on every drag step, random 100-600 x 80-480 frames on a
+ * 1920x1080 screen after raises, moves and removals, every query result is
+ * checked against the scan first
+ */
+
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+#define BENCH_CHECKS 100000
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// the reference: topmost frame containing x, y by looking at every slot
+static int linear_query(const LimeGeomStore *store, const uint32_t *stack,
+                        int x, int y) {
+  int best = -1;
+  uint32_t best_stack = 0;
+  for (size_t slot = 0; slot < store->slots; slot++) {
+    if (!(store->flags[slot] & LIME_GEOM_USED) || x < store->x[slot] ||
+        y < store->y[slot] || x >= store->x[slot] + store->width[slot] ||
+        y >= store->y[slot] + store->height[slot]) {
+      continue;
+    }
+    if (stack[slot] > best_stack) {
+      best_stack = stack[slot];
+      best = slot;
+    }
+  }
+  return best;
+}
+
+static void populate(LimeGeomStore *store, LimeSpatial *index, int frames) {
+  for (int i = 0; i < frames; i++) {
+    int slot = lime_geom_store_alloc(store, NULL);
+    LimeGeometry g = {rand() % 1800 - 50, rand() % 1000 - 50,
+                      100 + rand() % 500, 80 + rand() % 400};
+    lime_geom_store_set(store, slot, &g);
+    lime_spatial_update(index, store, slot);
+  }
+  for (int i = 0; i < frames / 3; i++) {
+    lime_spatial_raise(index, rand() % frames);
+  }
+  // churn: move some frames, close every fifth one touched
+  for (int i = 0; i < frames; i++) {
+    int slot = rand() % frames;
+    if (!(store->flags[slot] & LIME_GEOM_USED)) {
+      continue;
+    }
+    if (rand() % 5 == 0) {
+      lime_spatial_remove(index, slot);
+      lime_geom_store_free(store, slot);
+      continue;
+    }
+    store->x[slot] += rand() % 300 - 150;
+    store->y[slot] += rand() % 300 - 150;
+    lime_spatial_update(index, store, slot);
+  }
+}
+
+static int bench(int frames, int queries) {
+  LimeGeomStore *store = lime_geom_store_create();
+  LimeSpatial *index = lime_spatial_create(BENCH_WIDTH, BENCH_HEIGHT, 128);
+  populate(store, index, frames);
+
+  for (int i = 0; i < BENCH_CHECKS; i++) {
+    int x = rand() % (BENCH_WIDTH + 180) - 100;
+    int y = rand() % (BENCH_HEIGHT + 120) - 60;
+    if (lime_spatial_query(index, store, x, y) !=
+        linear_query(store, index->stack, x, y)) {
+      fprintf(stderr, "%d frames: query at %d,%d disagrees with the scan\n",
+              frames, x, y);
+      return -1;
+    }
+  }
+
+  int *xs = lime_malloc(sizeof(*xs) * queries);
+  int *ys = lime_malloc(sizeof(*ys) * queries);
+  for (int i = 0; i < queries; i++) {
+    xs[i] = rand() % BENCH_WIDTH;
+    ys[i] = rand() % BENCH_HEIGHT;
+  }
+  volatile int sink = 0;
+  double start = now_ns();
+  for (int i = 0; i < queries; i++) {
+    sink += lime_spatial_query(index, store, xs[i], ys[i]);
+  }
+  double grid = now_ns() - start;
+  start = now_ns();
+  for (int i = 0; i < queries; i++) {
+    sink += linear_query(store, index->stack, xs[i], ys[i]);
+  }
+  double linear = now_ns() - start;
+
+  // one frame dragged 1 px per step
+  int slot = 0;
+  while (!(store->flags[slot] & LIME_GEOM_USED)) {
+    slot++;
+  }
+  start = now_ns();
+  for (int i = 0; i < queries; i++) {
+    store->x[slot] = i % 1500;
+    lime_spatial_update(index, store, slot);
+  }
+  double drag = now_ns() - start;
+
+  printf("%8d %10.1f %10.1f %10.1f\n", frames, grid / queries,
+         linear / queries, drag / queries);
+  lime_free(xs);
+  lime_free(ys);
+  lime_spatial_destory(index);
+  lime_geom_store_destory(store);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  int queries = argc > 1 ? atoi(argv[1]) : 1000000;
+  if (queries <= 0) {
+    fprintf(stderr, "usage: %s [queries]\n", argv[0]);
+    return 1;
+  }
+  srand(1);
+  printf("%8s %10s %10s %10s\n", "frames", "grid ns", "linear ns", "drag ns");
+  for (int frames = 10; frames <= 1000; frames *= 10) {
+    if (bench(frames, queries) < 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "geometry.h"
+#include "mem.h"
+
+#define LIME_GEOM_STORE_INIT_CAPACITY 64
+
+LimeGeomStore *lime_geom_store_create() {
+  LimeGeomStore *store = lime_mallocz(sizeof(*store));
+  return store;
+}
+
+static int *lime_geom_store_grow_array(int *old, size_t count,
+                                       size_t capacity) {
+  int *array = lime_mallocz(sizeof(*array) * capacity);
+  if (array && old) {
+    memcpy(array, old, sizeof(*array) * count);
+  }
+  lime_free(old);
+  return array;
+}
+
+static int lime_geom_store_grow(LimeGeomStore *store) {
+  size_t capacity = store->capacity ? store->capacity * 2
+                                    : LIME_GEOM_STORE_INIT_CAPACITY;
+  size_t count = store->slots;
+  store->x = lime_geom_store_grow_array(store->x, count, capacity);
+  store->y = lime_geom_store_grow_array(store->y, count, capacity);
+  store->width = lime_geom_store_grow_array(store->width, count, capacity);
+  store->height = lime_geom_store_grow_array(store->height, count, capacity);
+  store->free_slots =
+      lime_geom_store_grow_array(store->free_slots, store->free_count, capacity);
+
+  uint32_t *flags = lime_mallocz(sizeof(*flags) * capacity);
+  if (store->flags) {
+    memcpy(flags, store->flags, sizeof(*flags) * count);
+  }
+  lime_free(store->flags);
+  store->flags = flags;
+
+  void **owners = lime_mallocz(sizeof(*owners) * capacity);
+  if (store->owners) {
+    memcpy(owners, store->owners, sizeof(*owners) * count);
+  }
+  lime_free(store->owners);
+  store->owners = owners;
+
+  if (!store->x || !store->y || !store->width || !store->height ||
+      !store->free_slots || !store->flags || !store->owners) {
+    return -1;
+  }
+  store->capacity = capacity;
+  return 0;
+}
+
+int lime_geom_store_alloc(LimeGeomStore *store, void *owner) {
+  int slot;
+  if (store->free_count > 0) {
+    slot = store->free_slots[--store->free_count];
+  } else {
+    if (store->slots == store->capacity && lime_geom_store_grow(store) < 0) {
+      return -1;
+    }
+    slot = store->slots++;
+  }
+  store->x[slot] = 0;
+  store->y[slot] = 0;
+  store->width[slot] = 0;
+  store->height[slot] = 0;
+  store->flags[slot] = LIME_GEOM_USED;
+  store->owners[slot] = owner;
+  return slot;
+}
+
+void lime_geom_store_free(LimeGeomStore *store, int slot) {
+  if (slot < 0 || !(store->flags[slot] & LIME_GEOM_USED)) {
+    return;
+  }
+  store->flags[slot] = 0;
+  store->owners[slot] = NULL;
+  store->free_slots[store->free_count++] = slot;
+}
+
+void lime_geom_store_destory(LimeGeomStore *store) {
+  if (!store) {
+    return;
+  }
+  lime_free(store->x);
+  lime_free(store->y);
+  lime_free(store->width);
+  lime_free(store->height);
+  lime_free(store->flags);
+  lime_free(store->owners);
+  lime_free(store->free_slots);
+  lime_free(store);
+}
@@ -0,0 +1,58 @@
+#ifndef __LIME_GEOMETRY_H__
+#define __LIME_GEOMETRY_H__
+
+#include "config.h"
+
+typedef struct lime_geometry {
+  int x;
+  int y;
+  int width;
+  int height;
+} LimeGeometry;
+
+#define LIME_GEOM_USED (1u << 0)
+
+/*
+ * frame geometry of every client as parallel arrays indexed by slot, a pass
+ * over all frames (placement, hit-testing, snapping) reads only the arrays
+ * it needs, linearly, instead of striding over whole LimeClient records,
+ * unused slots have flags 0 and are recycled through free_slots
+ */
+typedef struct lime_geom_store {
+  int *x;
+  int *y;
+  int *width;
+  int *height;
+  uint32_t *flags;
+  void **owners; // the object a slot belongs to, LimeClient for lime
+  size_t capacity;
+  size_t slots; // slots ever handed out, passes only need to look at these
+  int *free_slots;
+  size_t free_count;
+} LimeGeomStore;
+
+LimeGeomStore *lime_geom_store_create();
+
+// new slot with zero geometry, -1 when the arrays can not grow
+int lime_geom_store_alloc(LimeGeomStore *store, void *owner);
+
+void lime_geom_store_free(LimeGeomStore *store, int slot);
+
+void lime_geom_store_destory(LimeGeomStore *store);
+
+static inline LimeGeometry lime_geom_store_get(const LimeGeomStore *store,
+                                               int slot) {
+  LimeGeometry g = {store->x[slot], store->y[slot], store->width[slot],
+                    store->height[slot]};
+  return g;
+}
+
+static inline void lime_geom_store_set(LimeGeomStore *store, int slot,
+                                       const LimeGeometry *g) {
+  store->x[slot] = g->x;
+  store->y[slot] = g->y;
+  store->width[slot] = g->width;
+  store->height[slot] = g->height;
+}
+
+#endif
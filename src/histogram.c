@@ -0,0 +1,52 @@
+#include "histogram.h"
+
+static int lime_histogram_index(uint64_t value) {
+  if (value < LIME_HISTOGRAM_SUB) {
+    return value;
+  }
+  int msb = 63 - __builtin_clzll(value);
+  if (msb >= LIME_HISTOGRAM_MAX_BITS) {
+    return LIME_HISTOGRAM_BUCKETS - 1;
+  }
+  int shift = msb - LIME_HISTOGRAM_SUB_BITS;
+  return (shift + 1) * LIME_HISTOGRAM_SUB +
+         ((value >> shift) & (LIME_HISTOGRAM_SUB - 1));
+}
+
+static uint64_t lime_histogram_upper(int index) {
+  if (index < LIME_HISTOGRAM_SUB) {
+    return index;
+  }
+  int shift = index / LIME_HISTOGRAM_SUB - 1;
+  uint64_t sub = index % LIME_HISTOGRAM_SUB;
+  return ((LIME_HISTOGRAM_SUB + sub + 1) << shift) - 1;
+}
+
+void lime_histogram_add(LimeHistogram *h, uint64_t value) {
+  h->buckets[lime_histogram_index(value)]++;
+  h->count++;
+  if (value > h->max) {
+    h->max = value;
+  }
+}
+
+uint64_t lime_histogram_percentile(const LimeHistogram *h, double p) {
+  if (h->count == 0) {
+    return 0;
+  }
+  uint64_t rank = (uint64_t)(p / 100.0 * h->count + 0.5);
+  if (rank < 1) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (int i = 0; i < LIME_HISTOGRAM_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= rank) {
+      uint64_t upper = lime_histogram_upper(i);
+      return upper < h->max ? upper : h->max;
+    }
+  }
+  return h->max;
+}
+
+void lime_histogram_reset(LimeHistogram *h) { memset(h, 0, sizeof(*h)); }
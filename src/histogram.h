@@ -0,0 +1,32 @@
+#ifndef __LIME_HISTOGRAM_H__
+#define __LIME_HISTOGRAM_H__
+
+#include "config.h"
+
+/*
+ * log-linear latency histogram in the spirit of HdrHistogram: values below
+ * 2^LIME_HISTOGRAM_SUB_BITS are exact, above that every power of two is
+ * split into 2^LIME_HISTOGRAM_SUB_BITS buckets, so any recorded value is
+ * known to within 1/16 (6.25%), adding a value is a few bit operations
+ */
+#define LIME_HISTOGRAM_SUB_BITS 4
+#define LIME_HISTOGRAM_SUB (1 << LIME_HISTOGRAM_SUB_BITS)
+// largest tracked magnitude, 2^40 ns is about 18 minutes
+#define LIME_HISTOGRAM_MAX_BITS 40
+#define LIME_HISTOGRAM_BUCKETS                                                 \
+  ((LIME_HISTOGRAM_MAX_BITS - LIME_HISTOGRAM_SUB_BITS + 1) * LIME_HISTOGRAM_SUB)
+
+typedef struct lime_histogram {
+  uint64_t count;
+  uint64_t max;
+  uint32_t buckets[LIME_HISTOGRAM_BUCKETS];
+} LimeHistogram;
+
+void lime_histogram_add(LimeHistogram *h, uint64_t value);
+
+// upper bound of the bucket holding the p-th percentile (0 < p <= 100)
+uint64_t lime_histogram_percentile(const LimeHistogram *h, double p);
+
+void lime_histogram_reset(LimeHistogram *h);
+
+#endif
@@ -1,6 +1,9 @@
 #include "list.h"
 #include "mem.h"
 
+// entries of every list share one cache, created on first use
+static LimeSlabCache lime_list_entry_cache;
+
 LimeList *lime_list_create()
 {
 	LimeList *l = lime_mallocz(sizeof(*l));
@@ -9,10 +12,19 @@ LimeList *lime_list_create()
 
 int lime_list_add(LimeList *list, void *data)
 {
-	LimeListEntry *entry = lime_mallocz(sizeof(*entry));
+	if (lime_list_entry_cache.object_size == 0)
+	{
+		lime_slab_cache_init(&lime_list_entry_cache, "LimeListEntry", sizeof(LimeListEntry));
+	}
+	LimeListEntry *entry = lime_slab_alloc(&lime_list_entry_cache);
+	if (entry == NULL)
+	{
+		return -1;
+	}
 	entry->data = data;
 	entry->next = list->root;
 	list->root = entry;
+	return 0;
 }
 
 void lime_list_del(LimeList *list, void *data)
@@ -34,9 +46,11 @@ void lime_list_del(LimeList *list, void *data)
 	if (entry == list->root)
 	{
 		list->root = entry->next;
-		return;
 	}
-	pre->next = entry->next;
+	else
+	{
+		pre->next = entry->next;
+	}
 	lime_list_entry_destory(entry);
 	return;
 }
@@ -47,7 +61,7 @@ void lime_list_entry_destory(LimeListEntry *entry)
 	{
 		return;
 	}
-	lime_free(entry);
+	lime_slab_free(&lime_list_entry_cache, entry);
 }
 
 void lime_list_destory(LimeList *list)
@@ -56,9 +70,19 @@ void lime_list_destory(LimeList *list)
 	{
 		return;
 	}
-	for (LimeListEntry *entry = list->root; entry != NULL; entry = entry->next)
+	LimeListEntry *entry = list->root;
+	while (entry != NULL)
 	{
+		LimeListEntry *next = entry->next;
 		lime_list_entry_destory(entry);
+		entry = next;
 	}
 	lime_free(list);
+}
+
+void lime_list_cleanup()
+{
+	lime_slab_cache_release(&lime_list_entry_cache);
+	// the next lime_list_add sets the cache up again
+	lime_list_entry_cache.object_size = 0;
 }
\ No newline at end of file
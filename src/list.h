@@ -1,6 +1,8 @@
 #ifndef __LIME_LIST_H__
 #define __LIME_LIST_H__
 
+#include <stddef.h>
+
 typedef struct lime_list_entry
 {
 	void *data;
@@ -23,4 +25,60 @@ void lime_list_destory(LimeList *list);
 
 void lime_list_entry_destory(LimeListEntry *entry);
 
+// free the entry cache shared by all lists, once no list is left
+void lime_list_cleanup();
+
+/*
+ * intrusive circular doubly-linked list: the LimeLink lives inside the
+ * object, the list head is a LimeLink that points to itself when empty, so
+ * insert, remove and move to front are O(1) and never allocate
+ */
+typedef struct lime_link
+{
+	struct lime_link *prev;
+	struct lime_link *next;
+} LimeLink;
+
+#define lime_link_entry(link, type, member) ((type *)((char *)(link) - offsetof(type, member)))
+
+#define lime_link_for_each(pos, head) for (LimeLink *pos = (head)->next; pos != (head); pos = pos->next)
+
+static inline void lime_link_init(LimeLink *head)
+{
+	head->prev = head;
+	head->next = head;
+}
+
+static inline int lime_link_empty(const LimeLink *head)
+{
+	return head->next == head;
+}
+
+static inline void lime_link_add(LimeLink *head, LimeLink *link)
+{
+	link->prev = head;
+	link->next = head->next;
+	head->next->prev = link;
+	head->next = link;
+}
+
+static inline void lime_link_add_tail(LimeLink *head, LimeLink *link)
+{
+	lime_link_add(head->prev, link);
+}
+
+// unlinked nodes point to themselves, removing one twice is harmless
+static inline void lime_link_del(LimeLink *link)
+{
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	lime_link_init(link);
+}
+
+static inline void lime_link_move_to_front(LimeLink *head, LimeLink *link)
+{
+	lime_link_del(link);
+	lime_link_add(head, link);
+}
+
 #endif
\ No newline at end of file
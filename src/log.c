@@ -1,52 +1,225 @@
 #include "log.h"
+#include <pthread.h>
+#include <semaphore.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <time.h>
 
-static FILE *lime_log_file = NULL;
-void lime_log_printf(char *file, int line, int level, char *fmt, ...) {
+/*
+ * producers (any thread) format only the message body into a slot of a
+ * bounded lock-free ring (Vyukov's sequence number scheme), the writer
+ * thread adds the time/level/file prefix and writes whole batches
+ */
+#define LIME_LOG_RING_SIZE 4096
+#define LIME_LOG_MSG_SIZE 256
+#define LIME_LOG_BATCH_SIZE (64 * 1024)
 
-  time_t t;
-  time(&t);
-  struct tm *time_info = localtime(&t);
+typedef struct lime_log_record {
+  atomic_size_t seq;
+  struct timespec ts;
+  int level;
+  const char *file;
+  int line;
+  char msg[LIME_LOG_MSG_SIZE];
+} LimeLogRecord;
 
-  char log_fmt[1024] = {0};
-  char log[1024] = {0};
+int lime_log_level = LIME_LOG_COMPILE_LEVEL;
+
+static LimeLogRecord lime_log_ring[LIME_LOG_RING_SIZE];
+static atomic_size_t lime_log_head; // next slot to claim by producers
+static size_t lime_log_tail;        // next slot to read, writer only
+static atomic_uint_fast64_t lime_log_dropped;
+static atomic_int lime_log_stop;
+static sem_t lime_log_sem;
+static pthread_t lime_log_thread;
+static pthread_once_t lime_log_once = PTHREAD_ONCE_INIT;
+static int lime_log_running = 0;
+static FILE *lime_log_file = NULL;
+
+static const char *lime_log_level_name(int level) {
   switch (level) {
   case LIME_LOG_ERROR:
-    sprintf(log_fmt, "%d-%d-%dT%02d:%02d:%02d [ERROR] file:%s:%d %s\n",
-            time_info->tm_year + 1900, time_info->tm_mon + 1,
-            time_info->tm_mday, time_info->tm_hour, time_info->tm_min,
-            time_info->tm_sec, file, line, fmt);
-    break;
+    return "ERROR";
   case LIME_LOG_WARIN:
-    sprintf(log_fmt, "%d-%d-%dT%02d:%02d:%02d [WARING] file:%s:%d %s\n",
-            time_info->tm_year + 1900, time_info->tm_mon + 1,
-            time_info->tm_mday, time_info->tm_hour, time_info->tm_min,
-            time_info->tm_sec, file, line, fmt);
-    break;
+    return "WARING";
   case LIME_LOG_INFO:
-    sprintf(log_fmt, "%d-%d-%dT%02d:%02d:%02d [INFO] file:%s:%d %s\n",
-            time_info->tm_year + 1900, time_info->tm_mon + 1,
-            time_info->tm_mday, time_info->tm_hour, time_info->tm_min,
-            time_info->tm_sec, file, line, fmt);
-    break;
+    return "INFO";
   default:
-    sprintf(log_fmt, "%d-%d-%dT%02d:%02d:%02d [UNKNOW] file:%s:%d %s\n",
-            time_info->tm_year + 1900, time_info->tm_mon + 1,
-            time_info->tm_mday, time_info->tm_hour, time_info->tm_min,
-            time_info->tm_sec, file, line, fmt);
-    break;
+    return "UNKNOW";
   }
-  va_list args;
-  va_start(args, fmt);
-  vsprintf(log, log_fmt, args);
-  va_end(args);
-  if (lime_log_file == NULL) {
-    lime_log_file = fopen("lime.log", "ab");
+}
+
+// localtime() runs at most once per second of log output
+static const char *lime_log_time_string(time_t sec) {
+  static time_t cached_sec = -1;
+  static char cached[64];
+  if (sec != cached_sec) {
+    struct tm time_info;
+    localtime_r(&sec, &time_info);
+    snprintf(cached, sizeof(cached), "%d-%d-%dT%02d:%02d:%02d",
+             time_info.tm_year + 1900, time_info.tm_mon + 1,
+             time_info.tm_mday, time_info.tm_hour, time_info.tm_min,
+             time_info.tm_sec);
+    cached_sec = sec;
+  }
+  return cached;
+}
+
+static LimeLogRecord *lime_log_peek() {
+  LimeLogRecord *record = &lime_log_ring[lime_log_tail % LIME_LOG_RING_SIZE];
+  size_t seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+  if (seq != lime_log_tail + 1) {
+    return NULL;
+  }
+  return record;
+}
+
+static void lime_log_release(LimeLogRecord *record) {
+  atomic_store_explicit(&record->seq, lime_log_tail + LIME_LOG_RING_SIZE,
+                        memory_order_release);
+  lime_log_tail++;
+}
+
+static size_t lime_log_drain(char *batch, uint64_t *reported_drops) {
+  size_t len = 0;
+  LimeLogRecord *record;
+  while ((record = lime_log_peek()) != NULL) {
+    if (len + LIME_LOG_MSG_SIZE + 128 > LIME_LOG_BATCH_SIZE) {
+      break;
+    }
+    int n = snprintf(batch + len, LIME_LOG_BATCH_SIZE - len,
+                     "%s [%s] file:%s:%d %s\n",
+                     lime_log_time_string(record->ts.tv_sec),
+                     lime_log_level_name(record->level), record->file,
+                     record->line, record->msg);
+    if (n > 0) {
+      len += n;
+    }
+    lime_log_release(record);
+  }
+
+  uint64_t dropped = atomic_load(&lime_log_dropped);
+  if (dropped != *reported_drops) {
+    int n = snprintf(batch + len, LIME_LOG_BATCH_SIZE - len,
+                     "[WARING] log ring full, %llu records dropped\n",
+                     (unsigned long long)(dropped - *reported_drops));
+    if (n > 0) {
+      len += n;
+    }
+    *reported_drops = dropped;
+  }
+  return len;
+}
+
+static void *lime_log_writer(void *arg) {
+  static char batch[LIME_LOG_BATCH_SIZE];
+  uint64_t reported_drops = 0;
+  for (;;) {
+    sem_wait(&lime_log_sem);
+    int stop = atomic_load(&lime_log_stop);
+    size_t len;
+    while ((len = lime_log_drain(batch, &reported_drops)) > 0) {
+      if (lime_log_file) {
+        fwrite(batch, 1, len, lime_log_file);
+      }
+    }
+    if (lime_log_file) {
+      fflush(lime_log_file);
+    }
+    if (stop) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+static void lime_log_start() {
+  for (size_t i = 0; i < LIME_LOG_RING_SIZE; i++) {
+    atomic_init(&lime_log_ring[i].seq, i);
+  }
+  lime_log_file = fopen("lime.log", "ab");
+  sem_init(&lime_log_sem, 0, 0);
+  if (pthread_create(&lime_log_thread, NULL, lime_log_writer, NULL) == 0) {
+    lime_log_running = 1;
+    atexit(lime_log_close);
   }
+}
+
+void lime_log_close() {
+  if (!lime_log_running) {
+    return;
+  }
+  lime_log_running = 0;
+  atomic_store(&lime_log_stop, 1);
+  sem_post(&lime_log_sem);
+  pthread_join(lime_log_thread, NULL);
   if (lime_log_file) {
-//    fwrite(log, 1, strlen(log), lime_log_file);
-//    fflush(lime_log_file);
+    fclose(lime_log_file);
+    lime_log_file = NULL;
   }
-//  printf("%s", log);
+}
+
+void lime_log_set_level(int level) { lime_log_level = level; }
+
+int lime_log_parse_level(const char *name) {
+  if (strcmp(name, "none") == 0) {
+    return LIME_LOG_NONE;
+  }
+  if (strcmp(name, "error") == 0) {
+    return LIME_LOG_ERROR;
+  }
+  if (strcmp(name, "warin") == 0 || strcmp(name, "warning") == 0) {
+    return LIME_LOG_WARIN;
+  }
+  if (strcmp(name, "info") == 0) {
+    return LIME_LOG_INFO;
+  }
+  return -2;
+}
+
+uint64_t lime_log_dropped_count() { return atomic_load(&lime_log_dropped); }
+
+void lime_log_printf(char *file, int line, int level, char *fmt, ...) {
+  if (!lime_log_enabled(level)) {
+    return;
+  }
+  pthread_once(&lime_log_once, lime_log_start);
+  if (!lime_log_running) {
+    return;
+  }
+
+  // claim a slot, a full ring drops the record instead of blocking
+  LimeLogRecord *record;
+  size_t pos = atomic_load_explicit(&lime_log_head, memory_order_relaxed);
+  for (;;) {
+    record = &lime_log_ring[pos % LIME_LOG_RING_SIZE];
+    size_t seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&lime_log_head, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      atomic_fetch_add(&lime_log_dropped, 1);
+      return;
+    } else {
+      pos = atomic_load_explicit(&lime_log_head, memory_order_relaxed);
+    }
+  }
+
+  clock_gettime(CLOCK_REALTIME, &record->ts);
+  record->level = level;
+  record->file = file;
+  record->line = line;
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(record->msg, sizeof(record->msg), fmt, args);
+  va_end(args);
+
+  atomic_store_explicit(&record->seq, pos + 1, memory_order_release);
+  sem_post(&lime_log_sem);
 }
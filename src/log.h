@@ -2,17 +2,71 @@
 #define __LIME_LOG_H__
 
 //this is test version
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+#define LIME_LOG_NONE -1
 #define LIME_LOG_ERROR 0
 #define LIME_LOG_WARIN 0xf
 #define LIME_LOG_INFO 0xff
 
-#define lime_error(fmt, ...) lime_log_printf(__FILE__, __LINE__, LIME_LOG_ERROR, fmt, __VA_ARGS__)
-#define lime_warin(fmt, ...) lime_log_printf(__FILE__, __LINE__, LIME_LOG_WARIN, fmt, __VA_ARGS__)
-#define lime_info(fmt, ...) lime_log_printf(__FILE__, __LINE__, LIME_LOG_INFO, fmt, __VA_ARGS__)
+/*
+ * most verbose level compiled in, set through the LIME_LOG_LEVEL cmake
+ * option, calls above it compile to nothing
+ */
+#ifndef LIME_LOG_COMPILE_LEVEL
+#define LIME_LOG_COMPILE_LEVEL LIME_LOG_INFO
+#endif
+
+// most verbose level written at runtime, checked before any formatting
+extern int lime_log_level;
+
+#define lime_log_enabled(level) ((level) <= lime_log_level)
+
+#define lime_log_at(level, fmt, ...)                                           \
+  do {                                                                         \
+    if (lime_log_enabled(level))                                               \
+      lime_log_printf(__FILE__, __LINE__, level, fmt, __VA_ARGS__);            \
+  } while (0)
+
+// compiled out calls still type-check and use their arguments, the compiler
+// drops them
+#define lime_log_off(level, fmt, ...)                                          \
+  do {                                                                         \
+    if (0)                                                                     \
+      lime_log_printf(__FILE__, __LINE__, level, fmt, __VA_ARGS__);            \
+  } while (0)
+
+#if LIME_LOG_COMPILE_LEVEL >= LIME_LOG_ERROR
+#define lime_error(fmt, ...) lime_log_at(LIME_LOG_ERROR, fmt, __VA_ARGS__)
+#else
+#define lime_error(fmt, ...) lime_log_off(LIME_LOG_ERROR, fmt, __VA_ARGS__)
+#endif
+
+#if LIME_LOG_COMPILE_LEVEL >= LIME_LOG_WARIN
+#define lime_warin(fmt, ...) lime_log_at(LIME_LOG_WARIN, fmt, __VA_ARGS__)
+#else
+#define lime_warin(fmt, ...) lime_log_off(LIME_LOG_WARIN, fmt, __VA_ARGS__)
+#endif
+
+#if LIME_LOG_COMPILE_LEVEL >= LIME_LOG_INFO
+#define lime_info(fmt, ...) lime_log_at(LIME_LOG_INFO, fmt, __VA_ARGS__)
+#else
+#define lime_info(fmt, ...) lime_log_off(LIME_LOG_INFO, fmt, __VA_ARGS__)
+#endif
 
 void lime_log_printf(char *file, int line, int level, char *fmt, ...);
 
+void lime_log_set_level(int level);
+
+// "error", "warin", "info" or "none", -2 for anything else
+int lime_log_parse_level(const char *name);
+
+// flush pending records and stop the writer thread, also runs at exit
+void lime_log_close();
+
+// records lost because the ring was full
+uint64_t lime_log_dropped_count();
+
 #endif
@@ -1,14 +1,38 @@
+#include "list.h"
 #include "log.h"
 #include "manager.h"
+#include "mem.h"
+#include <stdlib.h>
 
 int main(int argc, char *argv[])
 {
+	const char *log_level = getenv("LIME_LOG_LEVEL");
+	if (log_level && lime_log_parse_level(log_level) >= LIME_LOG_NONE)
+	{
+		lime_log_set_level(lime_log_parse_level(log_level));
+	}
+
 	LimeWM *wm = lime_window_manager_create();
 	int ret = lime_window_manager_init(wm);
 	if (ret != 0)
 	{
+		lime_window_manager_destroy(wm);
+		lime_list_cleanup();
+		lime_mem_report(stderr);
 		return -1;
 	}
-	lime_window_manager_run(wm);
-	return 0;
+	const char *replay = getenv("LIME_REPLAY");
+	if (replay)
+	{
+		ret = lime_window_manager_replay(wm, replay);
+	}
+	else
+	{
+		lime_window_manager_run(wm);
+	}
+	lime_window_manager_destroy(wm);
+	lime_list_cleanup();
+	// everything is released by now, what is left is a leak
+	lime_mem_report(stderr);
+	return ret;
 }
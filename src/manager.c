@@ -1,6 +1,8 @@
 #include "manager.h"
 #include "log.h"
 #include "mem.h"
+#include "record.h"
+#include "trace.h"
 #include <X11/X.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -8,8 +10,72 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
+#ifdef LIME_HAVE_XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+#include <xcb/xcb.h>
+#ifdef LIME_HAVE_XLIB_XCB_H
+#include <X11/Xlib-xcb.h>
+#else
+// libX11-xcb installed without its header, the one call lime needs
+xcb_connection_t *XGetXCBConnection(Display *dpy);
+#endif
+
+#define LIME_DEFAULT_REFRESH_RATE 60
+#define LIME_EVENT_BATCH 64
+#define LIME_MAX_SOURCES 16
+#define LIME_SPATIAL_CELL_SIZE 128
+#define LIME_DEFAULT_SNAP 16
+#define LIME_MIN_FRAME_Y 10 // dragged frames stay below this
+#define LIME_DEFAULT_PLACE_CELL 16
+#define LIME_DEFAULT_TILE_COLUMNS 3
+#define CORNER_WIDTH 10
+#define LIME_MIN_FRAME_SIZE (CORNER_WIDTH * 3)
+
+/*
+ * calls that block for a reply are counted where they are made, by hand with
+ * LIME_ROUND_TRIPS, so a reply Xlib waits for at a call site nobody annotated
+ * is not counted, the first hit links the call site into
+ * lime_round_trip_sites for the report
+ */
+typedef struct lime_round_trip_site {
+  const char *func;
+  int line;
+  uint64_t count;
+  struct lime_round_trip_site *next;
+} LimeRoundTripSite;
+
+static LimeRoundTripSite *lime_round_trip_sites = NULL;
+
+static void count_round_trips(LimeWM *wm, LimeRoundTripSite *site, int n) {
+  if (site->count == 0) {
+    site->next = lime_round_trip_sites;
+    lime_round_trip_sites = site;
+  }
+  site->count += n;
+  wm->round_trips += n;
+}
+
+#define LIME_ROUND_TRIPS(wm, n)                                                \
+  do {                                                                         \
+    static LimeRoundTripSite site = {__func__, __LINE__, 0, NULL};             \
+    count_round_trips(wm, &site, n);                                           \
+  } while (0)
+
+// dispatch_event reads the clock only when something consumes the time
+#ifdef LIME_HISTOGRAM
+#define LIME_TIME_EVENTS 1
+#else
+#define LIME_TIME_EVENTS 0
+#endif
 
 static int wm_detected = 0;
 
@@ -23,9 +89,315 @@ static int onWMDetected(Display *Display, XErrorEvent *e) {
   return -1;
 }
 
+/*
+ * refresh rate of the screen in Hz, used to pace interactive move/resize,
+ * falls back to LIME_DEFAULT_REFRESH_RATE when RandR is not available
+ */
+static int query_refresh_rate(LimeWM *wm) {
+  int rate = 0;
+#ifdef LIME_HAVE_XRANDR
+  int event_base, error_base;
+  if (XRRQueryExtension(wm->main_display, &event_base, &error_base)) {
+    XRRScreenConfiguration *conf =
+        XRRGetScreenInfo(wm->main_display, wm->main_window);
+    if (conf) {
+      rate = XRRConfigCurrentRate(conf);
+      XRRFreeScreenConfigInfo(conf);
+    }
+  }
+#endif
+  if (rate <= 0) {
+    rate = LIME_DEFAULT_REFRESH_RATE;
+  }
+  return rate;
+}
+
+static int init_sources(LimeWM *wm);
+
+static char *const ATOM_NAMES[LIME_ATOM_COUNT] = {
+    [LIME_ATOM_WM_PROTOCOLS] = "WM_PROTOCOLS",
+    [LIME_ATOM_WM_DELETE_WINDOW] = "WM_DELETE_WINDOW",
+};
+
+static const KeySym KEY_SYMS[LIME_KEY_COUNT] = {
+    [LIME_KEY_TERMINAL] = XK_T,
+    [LIME_KEY_TERMINAL_ALT] = XK_t,
+    [LIME_KEY_CLOSE] = XK_F4,
+    [LIME_KEY_CYCLE] = XK_Tab,
+    [LIME_KEY_LAYOUT] = XK_space,
+    [LIME_KEY_ALT_L] = XK_Alt_L,
+    [LIME_KEY_ALT_R] = XK_Alt_R,
+};
+
+static const unsigned int CURSOR_SHAPES[LIME_CURSOR_COUNT] = {
+    [LIME_CURSOR_NORMAL] = XC_left_ptr,
+    [LIME_CURSOR_H_RESIZE] = XC_sb_h_double_arrow,
+    [LIME_CURSOR_V_RESIZE] = XC_sb_v_double_arrow,
+    [LIME_CURSOR_BL_CORNER] = XC_bottom_left_corner,
+    [LIME_CURSOR_BR_CORNER] = XC_bottom_right_corner,
+};
+
+// cursor shown over each decoration part
+static const LimeCursor SRC_CURSORS[LIME_WINDOW + 1] = {
+    [LIME_TITLE_BAR] = LIME_CURSOR_NORMAL,
+    [LIME_LSIDE] = LIME_CURSOR_H_RESIZE,
+    [LIME_RSIDE] = LIME_CURSOR_H_RESIZE,
+    [LIME_BSIDE] = LIME_CURSOR_V_RESIZE,
+    [LIME_LCORNER] = LIME_CURSOR_BL_CORNER,
+    [LIME_RCORNER] = LIME_CURSOR_BR_CORNER,
+    [LIME_FRAME] = LIME_CURSOR_NORMAL,
+    [LIME_WINDOW] = LIME_CURSOR_NORMAL,
+};
+
+static Cursor src_cursor(LimeWM *wm, LimeEventSrc src) {
+  return wm->cursors[SRC_CURSORS[src]];
+}
+
+/*
+ * atoms, keycodes and cursors are resolved once here so that the input
+ * handlers never have to ask the server, atoms go out as a single
+ * InternAtom batch
+ */
+static void init_resources(LimeWM *wm) {
+  XInternAtoms(wm->main_display, (char **)ATOM_NAMES, LIME_ATOM_COUNT, 0,
+               wm->atoms);
+  for (int i = 0; i < LIME_CURSOR_COUNT; i++) {
+    wm->cursors[i] = XCreateFontCursor(wm->main_display, CURSOR_SHAPES[i]);
+  }
+}
+
+// keycodes depend on the keyboard mapping, refreshed on MappingNotify
+static void load_keycodes(LimeWM *wm) {
+  // Xlib has no mapping cached at startup or after XRefreshKeyboardMapping,
+  // the first lookup fetches it with GetKeyboardMapping
+  LIME_ROUND_TRIPS(wm, 1);
+  for (int i = 0; i < LIME_KEY_COUNT; i++) {
+    wm->keycodes[i] = XKeysymToKeycode(wm->main_display, KEY_SYMS[i]);
+  }
+}
+
+static void grab_root_keys(LimeWM *wm) {
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_TERMINAL],
+           Mod1Mask | ControlMask, wm->main_window, false, GrabModeAsync,
+           GrabModeAsync);
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_TERMINAL_ALT],
+           Mod1Mask | Mod2Mask, wm->main_window, 0, GrabModeAsync,
+           GrabModeAsync);
+  // cycling has to work when no client has the focus as well, Shift cycles
+  // backward
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_CYCLE], Mod1Mask,
+           wm->main_window, 0, GrabModeAsync, GrabModeAsync);
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_CYCLE],
+           Mod1Mask | ShiftMask, wm->main_window, 0, GrabModeAsync,
+           GrabModeAsync);
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_LAYOUT], Mod1Mask,
+           wm->main_window, 0, GrabModeAsync, GrabModeAsync);
+}
+
+static void grab_root_buttons(LimeWM *wm) {
+  XGrabButton(wm->main_display, Button1, Mod1Mask, wm->main_window, 0,
+              ButtonPressMask | ButtonReleaseMask, GrabModeAsync,
+              GrabModeAsync, None, None);
+}
+
+static void grab_client_keys(LimeWM *wm, Window w) {
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_CLOSE], Mod1Mask, w, 0,
+           GrabModeAsync, GrabModeAsync);
+
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_CYCLE], Mod1Mask, w, 0,
+           GrabModeAsync, GrabModeAsync);
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_CYCLE],
+           Mod1Mask | ShiftMask, w, 0, GrabModeAsync, GrabModeAsync);
+
+  XGrabKey(wm->main_display, wm->keycodes[LIME_KEY_LAYOUT], Mod1Mask, w, 0,
+           GrabModeAsync, GrabModeAsync);
+}
+
+static void init_decor_mode(LimeWM *wm) {
+  const char *mode = getenv("LIME_DECOR");
+  if (mode && strcmp(mode, "hittest") == 0) {
+    wm->decor_mode = LIME_DECOR_HITTEST;
+  } else {
+    wm->decor_mode = LIME_DECOR_WINDOWS;
+    return;
+  }
+
+  wm->decor_gc = XCreateGC(wm->main_display, wm->main_window, 0, NULL);
+  lime_info("decoration mode %s", mode);
+}
+
+static void init_move_mode(LimeWM *wm) {
+  const char *mode = getenv("LIME_MOVE_MODE");
+  if (mode && strcmp(mode, "immediate") == 0) {
+    wm->move_mode = LIME_MOVE_IMMEDIATE;
+  } else {
+    wm->move_mode = LIME_MOVE_PACED;
+  }
+
+  int rate = query_refresh_rate(wm);
+  wm->pace_interval_ns = 1000000000L / rate;
+  wm->pace_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (wm->pace_fd < 0) {
+    lime_warin("timerfd_create failed: %s, using immediate move mode",
+               strerror(errno));
+    wm->move_mode = LIME_MOVE_IMMEDIATE;
+  }
+  lime_info("move mode %s, refresh rate %d Hz",
+            wm->move_mode == LIME_MOVE_PACED ? "paced" : "immediate", rate);
+}
+
+// LIME_SNAP=<px> is the distance frames snap to other frames at,
+// LIME_SNAP_RESIST=<px> the one for the screen edges, 0 turns either off
+static void init_snap(LimeWM *wm) {
+  const char *value = getenv("LIME_SNAP");
+  int threshold = value ? atoi(value) : LIME_DEFAULT_SNAP;
+  if (threshold < 0) {
+    threshold = 0;
+  }
+  value = getenv("LIME_SNAP_RESIST");
+  int resist = value ? atoi(value) : threshold * 2;
+  if (resist < 0) {
+    resist = 0;
+  }
+  lime_snap_init(&wm->snap, threshold, resist);
+  lime_info("snap %d px, screen edges %d px", threshold, resist);
+}
+
+// LIME_PLACE=<px> is the cell size new frames are placed on (0 keeps the
+// position the client asked for)
+static void init_place(LimeWM *wm) {
+  const char *value = getenv("LIME_PLACE");
+  int cell = value ? atoi(value) : LIME_DEFAULT_PLACE_CELL;
+  if (cell < 0) {
+    cell = 0;
+  }
+  lime_place_init(&wm->place, cell);
+  lime_info("placement cell %d px", cell);
+}
+
+/*
+ * root relative geometry of every active monitor, primary first, the whole
+ * screen is the only monitor when RandR is not available
+ */
+static void init_monitors(LimeWM *wm) {
+#ifdef LIME_HAVE_XRANDR
+  int event_base, error_base, count = 0;
+  if (XRRQueryExtension(wm->main_display, &event_base, &error_base)) {
+    XRRMonitorInfo *infos =
+        XRRGetMonitors(wm->main_display, wm->main_window, True, &count);
+    LIME_ROUND_TRIPS(wm, 1);
+    if (infos && count > 0) {
+      wm->monitors = lime_malloc(sizeof(*wm->monitors) * count);
+    }
+    if (wm->monitors) {
+      for (int i = 0; i < count; i++) {
+        // keep the primary monitor in front so placement prefers it
+        int at = infos[i].primary ? 0 : i;
+        if (at != i) {
+          wm->monitors[i] = wm->monitors[0];
+        }
+        LimeGeometry monitor = {infos[i].x, infos[i].y, infos[i].width,
+                                infos[i].height};
+        wm->monitors[at] = monitor;
+      }
+      wm->monitor_count = count;
+    }
+    if (infos) {
+      XRRFreeMonitors(infos);
+    }
+  }
+  if (wm->monitor_count > 0) {
+    lime_info("%d monitors", wm->monitor_count);
+    return;
+  }
+#endif
+  int screen = DefaultScreen(wm->main_display);
+  wm->monitors = lime_malloc(sizeof(*wm->monitors));
+  if (wm->monitors == NULL) {
+    return;
+  }
+  LimeGeometry monitor = {0, 0, DisplayWidth(wm->main_display, screen),
+                          DisplayHeight(wm->main_display, screen)};
+  wm->monitors[0] = monitor;
+  wm->monitor_count = 1;
+}
+
+static const char *const TILE_MODE_NAMES[LIME_TILE_MODE_COUNT] = {
+    [LIME_TILE_FLOATING] = "floating",
+    [LIME_TILE_MASTER_STACK] = "tile",
+    [LIME_TILE_COLUMNS] = "columns",
+};
+
+// LIME_LAYOUT=floating|tile|columns picks the initial tiling mode,
+// LIME_TILE_COLUMNS=<n> the number of columns of the columns mode
+static void init_tile(LimeWM *wm) {
+  LimeTileMode mode = LIME_TILE_FLOATING;
+  const char *value = getenv("LIME_LAYOUT");
+  for (int i = 0; value && i < LIME_TILE_MODE_COUNT; i++) {
+    if (strcmp(value, TILE_MODE_NAMES[i]) == 0) {
+      mode = i;
+    }
+  }
+  value = getenv("LIME_TILE_COLUMNS");
+  int columns = value ? atoi(value) : LIME_DEFAULT_TILE_COLUMNS;
+  LimeGeometry area = {0, 0, 0, 0};
+  if (wm->monitor_count > 0) {
+    area = wm->monitors[0];
+  }
+  lime_tile_init(&wm->tile, mode, columns, LIME_MIN_FRAME_SIZE, &area);
+  lime_info("layout %s, %d columns", TILE_MODE_NAMES[mode], wm->tile.columns);
+}
+
+// LIME_TRACE=<file> records every dispatched event, LIME_TRACE=1 picks
+// lime-<pid>.trace in the working directory
+static void init_trace() {
+  const char *path = getenv("LIME_TRACE");
+  if (path == NULL || path[0] == '\0' || strcmp(path, "0") == 0) {
+    return;
+  }
+  char name[64];
+  if (strcmp(path, "1") == 0) {
+    snprintf(name, sizeof(name), "lime-%d.trace", (int)getpid());
+    path = name;
+  }
+  if (lime_trace_open(path) < 0) {
+    lime_warin("can not open trace file %s: %s", path, strerror(errno));
+    return;
+  }
+  lime_info("tracing events to %s", path);
+}
+
+// LIME_RECORD=<file> saves the dispatched event stream for
+// lime_window_manager_replay
+static void init_record() {
+  const char *path = getenv("LIME_RECORD");
+  if (path == NULL || path[0] == '\0') {
+    return;
+  }
+  if (lime_record_open(path) < 0) {
+    lime_warin("can not open record file %s: %s", path, strerror(errno));
+    return;
+  }
+  lime_info("recording events to %s", path);
+}
+
 LimeWM *lime_window_manager_create() {
   LimeWM *wm = lime_mallocz(sizeof(*wm));
-  wm->clients = lime_list_create();
+  lime_link_init(&wm->clients);
+  lime_link_init(&wm->focus_ring);
+  wm->windows = lime_map_create();
+  wm->sources = lime_list_create();
+  wm->pace_fd = -1;
+  wm->epoll_fd = -1;
+  wm->signal_fd = -1;
+  wm->client_cache = lime_slab_cache_create("LimeClient", sizeof(LimeClient));
+  wm->geom_store = lime_geom_store_create();
+  LimeGeometry nowhere = {0, 0, 0, 0};
+  lime_tile_init(&wm->tile, LIME_TILE_FLOATING, 1, LIME_MIN_FRAME_SIZE,
+                 &nowhere);
+#ifdef LIME_HISTOGRAM
+  wm->latency = lime_mallocz(sizeof(*wm->latency) * LASTEvent);
+#endif
   return wm;
 }
 
@@ -37,14 +409,20 @@ int lime_window_manager_init(LimeWM *wm) {
   }
 
   wm->main_window = DefaultRootWindow(wm->main_display);
+  int screen = DefaultScreen(wm->main_display);
+  wm->spatial = lime_spatial_create(DisplayWidth(wm->main_display, screen),
+                                    DisplayHeight(wm->main_display, screen),
+                                    LIME_SPATIAL_CELL_SIZE);
+
+  init_resources(wm);
+  load_keycodes(wm);
   lime_info("create display done name %s", XDisplayString(wm->main_display));
 
   XSetErrorHandler(onWMDetected);
   XSelectInput(wm->main_display, wm->main_window,
                SubstructureRedirectMask | SubstructureNotifyMask);
-  XGrabKey(wm->main_display, XKeysymToKeycode(wm->main_display, XK_T),
-           Mod1Mask | ControlMask, wm->main_window, false, GrabModeAsync,
-           GrabModeAsync);
+  grab_root_keys(wm);
+  grab_root_buttons(wm);
   XSync(wm->main_display, 0);
   if (wm_detected) {
     lime_error("detected another window manager on display %s",
@@ -54,116 +432,134 @@ int lime_window_manager_init(LimeWM *wm) {
 
   XSetErrorHandler(onXError);
 
+  init_move_mode(wm);
+  init_decor_mode(wm);
+  init_snap(wm);
+  init_place(wm);
+  init_monitors(wm);
+  init_tile(wm);
+  init_trace();
+  init_record();
+
+  if (init_sources(wm) < 0) {
+    return -1;
+  }
+
   return 0;
 }
 
-static const char *const X_EVENT_TYPE_NAMES[] = {
-    "",
-    "",
-    "KeyPress",
-    "KeyRelease",
-    "ButtonPress",
-    "ButtonRelease",
-    "MotionNotify",
-    "EnterNotify",
-    "LeaveNotify",
-    "FocusIn",
-    "FocusOut",
-    "KeymapNotify",
-    "Expose",
-    "GraphicsExpose",
-    "NoExpose",
-    "VisibilityNotify",
-    "CreateNotify",
-    "DestroyNotify",
-    "UnmapNotify",
-    "MapNotify",
-    "MapRequest",
-    "ReparentNotify",
-    "ConfigureNotify",
-    "ConfigureRequest",
-    "GravityNotify",
-    "ResizeRequest",
-    "CirculateNotify",
-    "CirculateRequest",
-    "PropertyNotify",
-    "SelectionClear",
-    "SelectionRequest",
-    "SelectionNotify",
-    "ColormapNotify",
-    "ClientMessage",
-    "MappingNotify",
-    "GeneralEvent",
-};
-
 const char *ToString(const XEvent e) {
   if (e.type < 2 || e.type >= LASTEvent) {
     printf("UNKONW (%d)", e.type);
     return NULL;
   }
 
-  return X_EVENT_TYPE_NAMES[e.type];
+  return lime_event_name(e.type);
 }
 
-static LimeClient *get_client(Window w, LimeWM *wm) {
-  LimeClient *c = NULL;
-  for (LimeListEntry *entry = wm->clients->root; entry != NULL;
-       entry = entry->next) {
-    c = entry->data;
-    if (c->window == w) {
-      c->event_src = LIME_WINDOW;
-      break;
-    }
-    if (c->frame == w) {
-      c->event_src = LIME_FRAME;
-      break;
-    }
-    if (c->title == w) {
-      c->event_src = LIME_TITLE_BAR;
-      break;
-    }
-    if (c->leftSide == w) {
-      c->event_src = LIME_LSIDE;
-      break;
-    }
-    if (c->rightSide == w) {
-      c->event_src = LIME_RSIDE;
-      break;
-    }
-    if (c->downSide == w) {
-      c->event_src = LIME_BSIDE;
-      break;
-    }
-    if (c->downLeftCorner == w) {
-      c->event_src = LIME_LCORNER;
-      break;
-    }
-    if (c->downRightCorner == w) {
-      c->event_src = LIME_RCORNER;
-      break;
-    }
-    c = NULL;
+static LimeClient *get_client(Window w, LimeWM *wm, LimeEventSrc *src) {
+  LimeMapEntry *entry = lime_map_get(wm->windows, w);
+  if (entry == NULL) {
+    return NULL;
   }
-  return c;
+  if (src) {
+    *src = entry->tag;
+  }
+  return entry->data;
 }
 
 static LimeClient *get_client_use_frame(Window frame, LimeWM *wm) {
-
-  LimeClient *c = NULL;
-  for (LimeListEntry *entry = wm->clients->root; entry != NULL;
-       entry = entry->next) {
-    c = entry->data;
-    if (c->frame == frame) {
-      c->event_src = LIME_FRAME;
-      break;
-    }
-    c = NULL;
+  LimeEventSrc src;
+  LimeClient *c = get_client(frame, wm, &src);
+  if (c == NULL || src != LIME_FRAME) {
+    return NULL;
   }
   return c;
 }
 
+static void track_window(LimeWM *wm, LimeClient *c, Window w,
+                         LimeEventSrc src) {
+  if (w != None) {
+    lime_map_put(wm->windows, w, c, src);
+  }
+}
+
+static void untrack_client(LimeWM *wm, LimeClient *c) {
+  lime_map_del(wm->windows, c->window);
+  lime_map_del(wm->windows, c->frame);
+  lime_map_del(wm->windows, c->title);
+  lime_map_del(wm->windows, c->leftSide);
+  lime_map_del(wm->windows, c->rightSide);
+  lime_map_del(wm->windows, c->downSide);
+  lime_map_del(wm->windows, c->downLeftCorner);
+  lime_map_del(wm->windows, c->downRightCorner);
+}
+
+static void set_geometry(LimeGeometry *g, int x, int y, int width,
+                         int height) {
+  g->x = x;
+  g->y = y;
+  g->width = width;
+  g->height = height;
+}
+
+static LimeGeometry client_geometry(LimeWM *wm, LimeClient *c,
+                                    LimeEventSrc src) {
+  if (src == LIME_FRAME) {
+    return lime_geom_store_get(wm->geom_store, c->slot);
+  }
+  return c->geom[src];
+}
+
+static void set_client_geometry(LimeWM *wm, LimeClient *c, LimeEventSrc src,
+                                const LimeGeometry *g) {
+  if (src == LIME_FRAME) {
+    lime_geom_store_set(wm->geom_store, c->slot, g);
+    lime_spatial_update(wm->spatial, wm->geom_store, c->slot);
+  } else {
+    c->geom[src] = *g;
+  }
+}
+
+// topmost client whose frame contains the root coordinates, no X request
+static LimeClient *client_at(LimeWM *wm, int x, int y) {
+  int slot = lime_spatial_query(wm->spatial, wm->geom_store, x, y);
+  return slot < 0 ? NULL : wm->geom_store->owners[slot];
+}
+
+static void raise_client(LimeWM *wm, LimeClient *c) {
+  XRaiseWindow(wm->main_display, c->frame);
+  lime_spatial_raise(wm->spatial, c->slot);
+}
+
+static void dump_frame_pool(LimeWM *wm) {
+  fprintf(stderr, "frame pool: %d pooled, %llu hits, %llu misses\n",
+          wm->frame_pool_count, (unsigned long long)wm->frame_pool_hits,
+          (unsigned long long)wm->frame_pool_misses);
+}
+
+static void on_mapping_notify(XMappingEvent e, LimeWM *wm) {
+  XRefreshKeyboardMapping(&e);
+  if (e.request != MappingKeyboard && e.request != MappingModifier) {
+    return;
+  }
+  // grabs are per keycode, move them over to the new mapping
+  XUngrabKey(wm->main_display, AnyKey, AnyModifier, wm->main_window);
+  lime_link_for_each(link, &wm->clients) {
+    LimeClient *c = lime_link_entry(link, LimeClient, link);
+    XUngrabKey(wm->main_display, AnyKey, AnyModifier, c->window);
+  }
+  load_keycodes(wm);
+  grab_root_keys(wm);
+  lime_link_for_each(link, &wm->clients) {
+    LimeClient *c = lime_link_entry(link, LimeClient, link);
+    grab_client_keys(wm, c->window);
+  }
+}
+
 static void on_create_notify(XCreateWindowEvent e, LimeWM *wm) {
   XTextProperty p = {};
+  LIME_ROUND_TRIPS(wm, 1);
   XGetWMName(wm->main_display, e.window, &p);
   char **data = NULL;
   int count = 0;
@@ -177,6 +573,29 @@ static void on_destroy_notify(XDestroyWindowEvent e) {}
 
 static void on_reparent_notify(XReparentEvent e) {}
 
+/*
+ * keep the geometry cache in sync with changes lime did not make itself,
+ * for our own requests this confirms what configure_client() stored
+ */
+static void on_configure_notify(XConfigureEvent e, LimeWM *wm) {
+  if (e.send_event) {
+    // synthetic notifications carry root coordinates
+    return;
+  }
+  LimeEventSrc src;
+  LimeClient *c = get_client(e.window, wm, &src);
+  if (c == NULL) {
+    return;
+  }
+  if (e.serial < c->configure_serial) {
+    // a newer request of ours is still in flight, the cache already has it
+    return;
+  }
+  LimeGeometry g;
+  set_geometry(&g, e.x, e.y, e.width, e.height);
+  set_client_geometry(wm, c, src, &g);
+}
+
 static void on_configure_request(XConfigureRequestEvent e, LimeWM *wm) {
   XWindowChanges changes;
   changes.x = e.x;
@@ -198,6 +617,7 @@ static Window createTitlebar(LimeWM *wm, Window frame, int width) {
   // XAddToSaveSet(wm->main_display, title);
   XReparentWindow(wm->main_display, frame, title, 0, 0);
   XMapWindow(wm->main_display, title);
+  XDefineCursor(wm->main_display, title, src_cursor(wm, LIME_TITLE_BAR));
   XSelectInput(wm->main_display, title, EnterWindowMask | LeaveWindowMask);
   XGrabButton(wm->main_display, Button1, 0, title, 0,
               ButtonPressMask | ButtonReleaseMask, GrabModeAsync, GrabModeAsync,
@@ -206,8 +626,6 @@ static Window createTitlebar(LimeWM *wm, Window frame, int width) {
   return title;
 }
 
-#define CORNER_WIDTH 10
-
 static void grabButton1(LimeWM *wm, Window w) {
 
   XGrabButton(wm->main_display, Button1, 0, w, 0,
@@ -223,6 +641,7 @@ static Window createDownSide(LimeWM *wm, Window frame, int pwidth,
                           pwidth - CORNER_WIDTH * 2, 2, 0, 0, BG_COLOR);
   XReparentWindow(wm->main_display, frame, side, 0, 0);
   XMapWindow(wm->main_display, side);
+  XDefineCursor(wm->main_display, side, src_cursor(wm, LIME_BSIDE));
 
   XSelectInput(wm->main_display, side, EnterWindowMask | LeaveWindowMask);
   grabButton1(wm, side);
@@ -245,6 +664,8 @@ static Window createLRSide(LimeWM *wm, Window frame, int left, int pwidth,
 
   XReparentWindow(wm->main_display, frame, side, 0, 0);
   XSelectInput(wm->main_display, side, EnterWindowMask | LeaveWindowMask);
+  XDefineCursor(wm->main_display, side,
+                src_cursor(wm, left ? LIME_LSIDE : LIME_RSIDE));
   XMapWindow(wm->main_display, side);
   grabButton1(wm, side);
   return side;
@@ -261,27 +682,256 @@ static Window createCorner(LimeWM *wm, Window frame, int left, int pwidth,
   Window side = XCreateSimpleWindow(wm->main_display, frame, x, pheight - 2,
                                     CORNER_WIDTH, 2, 0, 0, BG_COLOR);
   XReparentWindow(wm->main_display, frame, side, 0, 0);
+  XDefineCursor(wm->main_display, side,
+                src_cursor(wm, left ? LIME_LCORNER : LIME_RCORNER));
   XMapWindow(wm->main_display, side);
   grabButton1(wm, side);
   return side;
 }
 
-static void frame(Window w, LimeWM *wm, int created_before) {
+typedef struct lime_window_info {
+  int valid;
+  int x;
+  int y;
+  int width;
+  int height;
+  int override_redirect;
+  int map_state;
+  int protocols;
+  int user_position; // USPosition in WM_NORMAL_HINTS
+} LimeWindowInfo;
+
+/*
+ * every request goes out first as a cookie, replies are collected afterwards,
+ * so count windows cost a single round trip instead of 3 * count, the
+ * WM_NORMAL_HINTS flags are only asked for when with_hints is set
+ */
+static void fetch_window_info(LimeWM *wm, const Window *windows,
+                              LimeWindowInfo *infos, size_t count,
+                              int with_hints) {
+  xcb_connection_t *conn = XGetXCBConnection(wm->main_display);
+  xcb_get_window_attributes_cookie_t *attr_cookies =
+      lime_malloc(sizeof(*attr_cookies) * count);
+  xcb_get_geometry_cookie_t *geom_cookies =
+      lime_malloc(sizeof(*geom_cookies) * count);
+  xcb_get_property_cookie_t *prop_cookies =
+      lime_malloc(sizeof(*prop_cookies) * count);
+  xcb_get_property_cookie_t *hints_cookies =
+      lime_malloc(sizeof(*hints_cookies) * count);
+
+  // requests queued by Xlib have to reach the server before ours
+  XFlush(wm->main_display);
+  for (size_t i = 0; i < count; i++) {
+    attr_cookies[i] = xcb_get_window_attributes(conn, windows[i]);
+    geom_cookies[i] = xcb_get_geometry(conn, windows[i]);
+    prop_cookies[i] = xcb_get_property(conn, 0, windows[i], wm->atoms[LIME_ATOM_WM_PROTOCOLS],
+                                       XCB_ATOM_ATOM, 0, 32);
+    // only the flags, the first field of WM_SIZE_HINTS
+    if (with_hints) {
+      hints_cookies[i] =
+          xcb_get_property(conn, 0, windows[i], XCB_ATOM_WM_NORMAL_HINTS,
+                           XCB_ATOM_WM_SIZE_HINTS, 0, 1);
+    }
+  }
+  xcb_flush(conn);
+  if (count > 0) {
+    LIME_ROUND_TRIPS(wm, 1);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    LimeWindowInfo *info = &infos[i];
+    memset(info, 0, sizeof(*info));
+    xcb_get_window_attributes_reply_t *attr =
+        xcb_get_window_attributes_reply(conn, attr_cookies[i], NULL);
+    xcb_get_geometry_reply_t *geom =
+        xcb_get_geometry_reply(conn, geom_cookies[i], NULL);
+    xcb_get_property_reply_t *prop =
+        xcb_get_property_reply(conn, prop_cookies[i], NULL);
+    if (attr && geom) {
+      info->valid = 1;
+      info->x = geom->x;
+      info->y = geom->y;
+      info->width = geom->width;
+      info->height = geom->height;
+      info->override_redirect = attr->override_redirect;
+      info->map_state = attr->map_state;
+    }
+    if (prop && prop->format == 32) {
+      const xcb_atom_t *atoms = xcb_get_property_value(prop);
+      int n = xcb_get_property_value_length(prop) / sizeof(xcb_atom_t);
+      for (int j = 0; j < n; j++) {
+        if (atoms[j] == wm->atoms[LIME_ATOM_WM_DELETE_WINDOW]) {
+          info->protocols |= LIME_PROTOCOL_DELETE_WINDOW;
+        }
+      }
+    }
+    xcb_get_property_reply_t *hints =
+        with_hints ? xcb_get_property_reply(conn, hints_cookies[i], NULL)
+                   : NULL;
+    if (hints && hints->format == 32 &&
+        xcb_get_property_value_length(hints) >= 4) {
+      const uint32_t *flags = xcb_get_property_value(hints);
+      info->user_position = (*flags & USPosition) != 0;
+    }
+    free(attr);
+    free(geom);
+    free(prop);
+    free(hints);
+  }
+
+  lime_free(attr_cookies);
+  lime_free(geom_cookies);
+  lime_free(prop_cookies);
+  lime_free(hints_cookies);
+}
+
+static Window client_window(LimeClient *c, LimeEventSrc src) {
+  switch (src) {
+  case LIME_TITLE_BAR:
+    return c->title;
+  case LIME_LSIDE:
+    return c->leftSide;
+  case LIME_RSIDE:
+    return c->rightSide;
+  case LIME_BSIDE:
+    return c->downSide;
+  case LIME_LCORNER:
+    return c->downLeftCorner;
+  case LIME_RCORNER:
+    return c->downRightCorner;
+  case LIME_FRAME:
+    return c->frame;
+  case LIME_WINDOW:
+    return c->window;
+  }
+  return None;
+}
+
+/*
+ * geometry of the frame (root relative) and of everything inside it (frame
+ * relative) for a frame at x, y with the given size
+ */
+static void compute_layout(LimeWM *wm, int x, int y, int w, int h,
+                           LimeGeometry *geom) {
+  memset(geom, 0, sizeof(*geom) * (LIME_WINDOW + 1));
+  set_geometry(&geom[LIME_FRAME], x, y, w, h);
+  if (wm->decor_mode == LIME_DECOR_HITTEST) {
+    set_geometry(&geom[LIME_WINDOW], LIME_SIDE_WIDTH, LIME_TITLE_HEIGHT,
+                 w - 2 * LIME_SIDE_WIDTH,
+                 h - LIME_TITLE_HEIGHT - LIME_SIDE_WIDTH);
+    return;
+  }
+  set_geometry(&geom[LIME_WINDOW], 0, 10, w, h - 10);
+  set_geometry(&geom[LIME_TITLE_BAR], 0, 0, w, 10);
+  set_geometry(&geom[LIME_BSIDE], CORNER_WIDTH, h - 2, w - CORNER_WIDTH * 2,
+               2);
+  set_geometry(&geom[LIME_LSIDE], 0, 10, 2, h - 2);
+  set_geometry(&geom[LIME_RSIDE], w - 2, 10, 2, h - 2);
+}
+
+/*
+ * move/resize the frame and its content to the given frame geometry, only
+ * windows whose cached geometry differs get a request
+ */
+static void configure_client(LimeWM *wm, LimeClient *c, int x, int y, int w,
+                             int h) {
+  // smaller frames leave no room for the client inside the decorations and
+  // the server would reject the sizes
+  if (w < LIME_MIN_FRAME_SIZE) {
+    w = LIME_MIN_FRAME_SIZE;
+  }
+  if (h < LIME_MIN_FRAME_SIZE) {
+    h = LIME_MIN_FRAME_SIZE;
+  }
+  LimeGeometry next[LIME_WINDOW + 1];
+  compute_layout(wm, x, y, w, h, next);
+  for (int src = 0; src <= LIME_WINDOW; src++) {
+    Window win = client_window(c, src);
+    if (win == None) {
+      continue;
+    }
+    LimeGeometry cur = client_geometry(wm, c, src);
+    int moved = cur.x != next[src].x || cur.y != next[src].y;
+    int resized =
+        cur.width != next[src].width || cur.height != next[src].height;
+    if (moved && resized) {
+      XMoveResizeWindow(wm->main_display, win, next[src].x, next[src].y,
+                        next[src].width, next[src].height);
+    } else if (moved) {
+      XMoveWindow(wm->main_display, win, next[src].x, next[src].y);
+    } else if (resized) {
+      XResizeWindow(wm->main_display, win, next[src].width, next[src].height);
+    }
+    set_client_geometry(wm, c, src, &next[src]);
+  }
+  c->configure_serial = NextRequest(wm->main_display) - 1;
+}
+
+/*
+ * take a frame left over by unfame() and fit it to info, the decorations are
+ * moved into place instead of being created again
+ */
+static int take_pooled_frame(LimeWM *wm, LimeClient *c,
+                             const LimeWindowInfo *info) {
+  if (wm->frame_pool_count == 0) {
+    wm->frame_pool_misses++;
+    return 0;
+  }
+  wm->frame_pool_hits++;
+  LimeFrameSet *set = &wm->frame_pool[--wm->frame_pool_count];
+  c->frame = set->frame;
+  c->title = set->title;
+  c->downSide = set->downSide;
+  c->leftSide = set->leftSide;
+  c->rightSide = set->rightSide;
+
+  // the old geometry of a pooled frame is unknown, force every request,
+  // except for the client which frame_with_info() reparents itself
+  LimeGeometry next[LIME_WINDOW + 1];
+  compute_layout(wm, info->x, info->y, info->width, info->height, next);
+  for (int src = 0; src <= LIME_WINDOW; src++) {
+    LimeGeometry unknown;
+    set_geometry(&unknown, -1, -1, -1, -1);
+    set_client_geometry(wm, c, src, src == LIME_WINDOW ? &next[src] : &unknown);
+  }
+  configure_client(wm, c, info->x, info->y, info->width, info->height);
+  lime_info("frame pool hit %llu miss %llu",
+            (unsigned long long)wm->frame_pool_hits,
+            (unsigned long long)wm->frame_pool_misses);
+  return 1;
+}
+
+/*
+ * keep the (already unmapped and emptied) frame of c for the next client,
+ * returns 0 when the pool is full and the frame has to be destroyed
+ */
+static int return_frame_to_pool(LimeWM *wm, LimeClient *c) {
+  if (wm->frame_pool_count >= LIME_FRAME_POOL_SIZE) {
+    return 0;
+  }
+  LimeFrameSet *set = &wm->frame_pool[wm->frame_pool_count++];
+  set->frame = c->frame;
+  set->title = c->title;
+  set->downSide = c->downSide;
+  set->leftSide = c->leftSide;
+  set->rightSide = c->rightSide;
+  return 1;
+}
+
+/*
+ * frame w using already fetched attributes, issues no round trip so a batch
+ * of windows can be framed while the server is grabbed
+ */
+static void frame_with_info(Window w, LimeWM *wm,
+                            const LimeWindowInfo *info, int created_before) {
   const uint32_t BORDER_WIDTH = 0;
   const uint32_t BORDER_COLOR = 0x118888;
   const uint32_t BG_COLOR = 0x222222;
+  const LimeWindowInfo x_window_attrs = *info;
 
-  XWindowAttributes x_window_attrs;
-  XGetWindowAttributes(wm->main_display, w, &x_window_attrs);
-  Atom *protocols;
-  Atom *ap;
-  int n, i;
-  int status = XGetWMProtocols(wm->main_display, w, &protocols, &n);
-
-  if (status && (protocols != NULL)) {
-    for (i = 0, ap = protocols; i < n; i++, ap++) {
-      printf("ap: %d\n", *ap);
-    }
+  if (!x_window_attrs.valid) {
+    lime_info("window %d is gone before it could be framed", w);
+    return;
   }
 
   if (created_before) {
@@ -291,41 +941,116 @@ static void frame(Window w, LimeWM *wm, int created_before) {
     }
   }
 
-  const Window frame = XCreateSimpleWindow(
-      wm->main_display, wm->main_window, x_window_attrs.x, x_window_attrs.y,
-      x_window_attrs.width, x_window_attrs.height, BORDER_WIDTH, BORDER_COLOR,
-      BG_COLOR);
-  XSelectInput(wm->main_display, frame,
-               SubstructureNotifyMask | SubstructureRedirectMask);
-  XAddToSaveSet(wm->main_display, w);
-  XResizeWindow(wm->main_display, w, x_window_attrs.width,
-                x_window_attrs.height - 10);
-  XReparentWindow(wm->main_display, w, frame, 0, 10);
-  XMapWindow(wm->main_display, frame);
-
-  Window title = createTitlebar(wm, frame, x_window_attrs.width);
+  LimeClient *c = lime_slab_alloc(wm->client_cache);
+  if (c == NULL) {
+    lime_error("out of memory framing window %lu", w);
+    return;
+  }
+  c->slot = lime_geom_store_alloc(wm->geom_store, c);
+  if (c->slot < 0) {
+    lime_error("out of memory framing window %lu", w);
+    lime_slab_free(wm->client_cache, c);
+    return;
+  }
+  c->hover_src = LIME_FRAME;
+  lime_tile_node_init(&c->tile, c->slot);
+
+  int pooled = take_pooled_frame(wm, c, &x_window_attrs);
+  if (!pooled) {
+    c->frame = XCreateSimpleWindow(
+        wm->main_display, wm->main_window, x_window_attrs.x, x_window_attrs.y,
+        x_window_attrs.width, x_window_attrs.height, BORDER_WIDTH,
+        BORDER_COLOR, BG_COLOR);
+  }
+  const Window frame = c->frame;
+
+  if (wm->decor_mode == LIME_DECOR_HITTEST) {
+    // the frame itself is the only decoration, the client sits inside the
+    // painted title and side strips so the frame sees pointer input there
+    if (!pooled) {
+      XSelectInput(wm->main_display, frame,
+                   SubstructureNotifyMask | SubstructureRedirectMask |
+                       ButtonPressMask | ButtonReleaseMask | PointerMotionMask |
+                       EnterWindowMask | LeaveWindowMask | ExposureMask);
+    }
+    XAddToSaveSet(wm->main_display, w);
+    XResizeWindow(wm->main_display, w,
+                  x_window_attrs.width - 2 * LIME_SIDE_WIDTH,
+                  x_window_attrs.height - LIME_TITLE_HEIGHT - LIME_SIDE_WIDTH);
+    XReparentWindow(wm->main_display, w, frame, LIME_SIDE_WIDTH,
+                    LIME_TITLE_HEIGHT);
+    // a pooled frame keeps its old stacking position, the spatial index puts
+    // every new frame on top
+    if (pooled) {
+      XMapRaised(wm->main_display, frame);
+    } else {
+      XMapWindow(wm->main_display, frame);
+    }
+  } else if (pooled) {
+    XAddToSaveSet(wm->main_display, w);
+    XResizeWindow(wm->main_display, w, x_window_attrs.width,
+                  x_window_attrs.height - 10);
+    XReparentWindow(wm->main_display, w, frame, 0, 10);
+    // the sides overlap the client, keep them stacked above it
+    XLowerWindow(wm->main_display, w);
+    // on top like a new frame, as the spatial index has it
+    XMapRaised(wm->main_display, frame);
+  } else {
+    XSelectInput(wm->main_display, frame,
+                 SubstructureNotifyMask | SubstructureRedirectMask);
+    XAddToSaveSet(wm->main_display, w);
+    XResizeWindow(wm->main_display, w, x_window_attrs.width,
+                  x_window_attrs.height - 10);
+    XReparentWindow(wm->main_display, w, frame, 0, 10);
+    XMapWindow(wm->main_display, frame);
 
-  LimeClient *c = lime_mallocz(sizeof(*c));
+    c->title = createTitlebar(wm, frame, x_window_attrs.width);
 
-  c->downSide =
-      createDownSide(wm, frame, x_window_attrs.width, x_window_attrs.height);
+    c->downSide =
+        createDownSide(wm, frame, x_window_attrs.width, x_window_attrs.height);
 
-  c->leftSide =
-      createLRSide(wm, frame, 1, x_window_attrs.width, x_window_attrs.height);
+    c->leftSide =
+        createLRSide(wm, frame, 1, x_window_attrs.width, x_window_attrs.height);
 
-  c->rightSide =
-      createLRSide(wm, frame, 0, x_window_attrs.width, x_window_attrs.height);
+    c->rightSide =
+        createLRSide(wm, frame, 0, x_window_attrs.width, x_window_attrs.height);
 
-  //c->downLeftCorner =
-  //    createCorner(wm, frame, 1, x_window_attrs.width, x_window_attrs.height);
+    // c->downLeftCorner =
+    //    createCorner(wm, frame, 1, x_window_attrs.width,
+    //    x_window_attrs.height);
 
-  //c->downRightCorner =
-  //    createCorner(wm, frame, 0, x_window_attrs.width, x_window_attrs.height);
+    // c->downRightCorner =
+    //    createCorner(wm, frame, 0, x_window_attrs.width,
+    //    x_window_attrs.height);
+  }
 
-  c->frame = frame;
   c->window = w;
-  c->title = title;
-  lime_list_add(wm->clients, c);
+  c->protocols = x_window_attrs.protocols;
+  // FocusIn keeps the focus ring in most recently used order
+  XSelectInput(wm->main_display, w, FocusChangeMask);
+  if (!pooled) {
+    // new windows were created exactly at their layout
+    LimeGeometry layout[LIME_WINDOW + 1];
+    compute_layout(wm, x_window_attrs.x, x_window_attrs.y,
+                   x_window_attrs.width, x_window_attrs.height, layout);
+    for (int src = 0; src <= LIME_WINDOW; src++) {
+      set_client_geometry(wm, c, src, &layout[src]);
+    }
+  }
+  lime_link_add(&wm->clients, &c->link);
+  // not focused yet, the least recently used client
+  lime_link_add_tail(&wm->focus_ring, &c->focus_link);
+  // laid out by the next tile_clients pass
+  lime_tile_insert(&wm->tile, &c->tile);
+
+  track_window(wm, c, c->window, LIME_WINDOW);
+  track_window(wm, c, c->frame, LIME_FRAME);
+  track_window(wm, c, c->title, LIME_TITLE_BAR);
+  track_window(wm, c, c->leftSide, LIME_LSIDE);
+  track_window(wm, c, c->rightSide, LIME_RSIDE);
+  track_window(wm, c, c->downSide, LIME_BSIDE);
+  track_window(wm, c, c->downLeftCorner, LIME_LCORNER);
+  track_window(wm, c, c->downRightCorner, LIME_RCORNER);
 
   // XGrabPointer(
   //	wm->main_display,
@@ -339,29 +1064,110 @@ static void frame(Window w, LimeWM *wm, int created_before) {
   //	CurrentTime
   //);
 
-  XGrabKey(wm->main_display, XKeysymToKeycode(wm->main_display, XK_F4),
-           Mod1Mask, w, 0, GrabModeAsync, GrabModeAsync);
-
-  XGrabKey(wm->main_display, XKeysymToKeycode(wm->main_display, XK_Tab),
-           Mod1Mask, w, 0, GrabModeAsync, GrabModeAsync);
+  grab_client_keys(wm, w);
 
   lime_info("framed widnow %d [%d]", w, frame);
 }
 
+/*
+ * apply the tiling layout, only the columns changed since the last pass are
+ * recomputed and every frame that moved is configured in one batch, flushed
+ * once at the end
+ */
+static void tile_clients(LimeWM *wm) {
+  int count = lime_tile_layout(&wm->tile, wm->geom_store);
+  if (count < 0) {
+    lime_error("out of memory laying out %s",
+               TILE_MODE_NAMES[wm->tile.mode]);
+    return;
+  }
+  if (count == 0) {
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    const LimeTileChange *change = &wm->tile.changes[i];
+    LimeClient *c = wm->geom_store->owners[change->slot];
+    configure_client(wm, c, change->geom.x, change->geom.y,
+                     change->geom.width, change->geom.height);
+  }
+  XFlush(wm->main_display);
+  lime_info("layout pass configured %d clients", count);
+}
+
+// tile every client again, the oldest first, in the next mode
+static void switch_tile_mode(LimeWM *wm) {
+  lime_tile_clear(&wm->tile);
+  wm->tile.mode = (wm->tile.mode + 1) % LIME_TILE_MODE_COUNT;
+  for (LimeLink *pos = wm->clients.prev; pos != &wm->clients;
+       pos = pos->prev) {
+    lime_tile_insert(&wm->tile,
+                     &lime_link_entry(pos, LimeClient, link)->tile);
+  }
+  lime_info("layout %s", TILE_MODE_NAMES[wm->tile.mode]);
+  tile_clients(wm);
+}
+
+/*
+ * move a new frame to the least covered spot over the monitors unless the
+ * user asked for a position, the frame is created there directly
+ */
+static void place_window(LimeWM *wm, LimeWindowInfo *info) {
+  // the tiling layout decides instead
+  if (!info->valid || info->user_position ||
+      wm->tile.mode != LIME_TILE_FLOATING) {
+    return;
+  }
+  int x, y;
+  int covered =
+      lime_place_find(&wm->place, wm->geom_store, -1, wm->monitors,
+                      wm->monitor_count, info->width, info->height, &x, &y);
+  if (covered < 0) {
+    return;
+  }
+  lime_info("placed %dx%d at %d,%d over %d covered cells", info->width,
+            info->height, x, y, covered);
+  info->x = x;
+  info->y = y;
+}
+
 static void on_map_request(XMapRequestEvent e, LimeWM *wm) {
-  frame(e.window, wm, 0);
+  LimeWindowInfo info;
+  fetch_window_info(wm, &e.window, &info, 1, 1);
+  place_window(wm, &info);
+  frame_with_info(e.window, wm, &info, 0);
+  tile_clients(wm);
   XMapWindow(wm->main_display, e.window);
 }
 
+static void disarm_pace_timer(LimeWM *wm);
+
 static void unfame(Window w, LimeWM *wm, LimeClient *c) {
   Window frame = c->frame;
+  if (wm->grab_client == c) {
+    wm->grab_client = NULL;
+    if (wm->pace_armed) {
+      disarm_pace_timer(wm);
+    }
+  }
+  if (wm->cycle_client == c) {
+    wm->cycle_client = NULL;
+    XUngrabKeyboard(wm->main_display, CurrentTime);
+  }
+  XSelectInput(wm->main_display, w, NoEventMask);
   XUnmapWindow(wm->main_display, frame);
   XReparentWindow(wm->main_display, w, wm->main_window, 0, 0);
 
   XRemoveFromSaveSet(wm->main_display, w);
-  XDestroyWindow(wm->main_display, frame);
-  lime_list_del(wm->clients, c);
-  lime_free(c);
+  untrack_client(wm, c);
+  if (!return_frame_to_pool(wm, c)) {
+    XDestroyWindow(wm->main_display, frame);
+  }
+  lime_link_del(&c->link);
+  lime_link_del(&c->focus_link);
+  lime_tile_remove(&wm->tile, &c->tile);
+  lime_spatial_remove(wm->spatial, c->slot);
+  lime_geom_store_free(wm->geom_store, c->slot);
+  lime_slab_free(wm->client_cache, c);
   lime_info("unframed window %d [%d]", w, frame);
 }
 
@@ -373,35 +1179,123 @@ static void on_unmap_notify(XUnmapEvent e, LimeWM *wm) {
     return;
   }
 
-  LimeClient *c = get_client(e.window, wm);
+  LimeEventSrc src;
+  LimeClient *c = get_client(e.window, wm, &src);
 
-  if (c == NULL) {
+  if (c == NULL || src != LIME_WINDOW) {
     lime_info("unmap notify can not find window %d", e.window);
     return;
   }
   unfame(e.window, wm, c);
+  tile_clients(wm);
 }
 
-static void on_button_release(XButtonEvent e, LimeWM *wm, XEvent *xe) {
-  LimeClient *c = NULL;
-  c = get_client(e.window, wm);
-  if (c == NULL) {
-    lime_error("can not find window %d", e.window);
-    printf("can not find window\n");
-    return;
+/*
+ * map a point in frame coordinates to the decoration part under it, mirrors
+ * the layout of the child windows used by LIME_DECOR_WINDOWS
+ */
+static LimeEventSrc hit_test(LimeWM *wm, LimeClient *c, int x, int y) {
+  if (y < LIME_TITLE_HEIGHT) {
+    return LIME_TITLE_BAR;
   }
+  if (x < LIME_SIDE_WIDTH) {
+    return LIME_LSIDE;
+  }
+  const int w = wm->geom_store->width[c->slot];
+  const int h = wm->geom_store->height[c->slot];
+  if (x >= w - LIME_SIDE_WIDTH) {
+    return LIME_RSIDE;
+  }
+  if (y >= h - LIME_SIDE_WIDTH && x >= CORNER_WIDTH && x < w - CORNER_WIDTH) {
+    return LIME_BSIDE;
+  }
+  return LIME_FRAME;
+}
 
-  if (c->event_src == LIME_TITLE_BAR) {
-    c->on_drag = 0;
-    XUngrabPointer(wm->main_display, 0);
-  } else if (c->event_src == LIME_LSIDE) {
-    c->on_left_resize = 0;
-    XUngrabPointer(wm->main_display, 0);
-  } else if (c->event_src == LIME_RSIDE) {
+/*
+ * resolve the event source of a pointer event, in hit-test mode events on
+ * the frame are split by position
+ */
+static LimeClient *get_pointer_client(LimeWM *wm, Window w, int x, int y,
+                                      LimeEventSrc *src) {
+  LimeClient *c = get_client(w, wm, src);
+  if (c && *src == LIME_FRAME && wm->decor_mode == LIME_DECOR_HITTEST) {
+    *src = hit_test(wm, c, x, y);
+  }
+  return c;
+}
+
+// the window holding the pointer grab during drag and resize
+static Window grab_window(LimeClient *c) {
+  return c->title != None ? c->title : c->frame;
+}
+
+static void paint_decorations(LimeWM *wm, LimeClient *c) {
+  const int w = wm->geom_store->width[c->slot];
+  const int h = wm->geom_store->height[c->slot];
+  XSetForeground(wm->main_display, wm->decor_gc, 0xf22222);
+  XFillRectangle(wm->main_display, c->frame, wm->decor_gc, 0, 0, w,
+                 LIME_TITLE_HEIGHT);
+  XSetForeground(wm->main_display, wm->decor_gc, 0x725222);
+  XFillRectangle(wm->main_display, c->frame, wm->decor_gc, 0,
+                 LIME_TITLE_HEIGHT, LIME_SIDE_WIDTH, h - LIME_TITLE_HEIGHT);
+  XFillRectangle(wm->main_display, c->frame, wm->decor_gc,
+                 w - LIME_SIDE_WIDTH, LIME_TITLE_HEIGHT, LIME_SIDE_WIDTH,
+                 h - LIME_TITLE_HEIGHT);
+  XFillRectangle(wm->main_display, c->frame, wm->decor_gc, CORNER_WIDTH,
+                 h - LIME_SIDE_WIDTH, w - CORNER_WIDTH * 2, LIME_SIDE_WIDTH);
+}
+
+static void on_expose(XExposeEvent e, LimeWM *wm) {
+  if (e.count != 0) {
+    return;
+  }
+  LimeClient *c = get_client_use_frame(e.window, wm);
+  if (c == NULL || wm->decor_mode != LIME_DECOR_HITTEST) {
+    return;
+  }
+  paint_decorations(wm, c);
+}
+
+static void update_hover_cursor(LimeWM *wm, LimeClient *c, LimeEventSrc src) {
+  if (c->hover_src == src) {
+    return;
+  }
+  c->hover_src = src;
+  XDefineCursor(wm->main_display, c->frame, src_cursor(wm, src));
+}
+
+static void flush_paced_motion(LimeWM *wm);
+static void disarm_pace_timer(LimeWM *wm);
+
+static void on_button_release(XButtonEvent e, LimeWM *wm, XEvent *xe) {
+  LimeEventSrc src;
+  LimeClient *c = NULL;
+  c = get_pointer_client(wm, e.window, e.x, e.y, &src);
+  if (c == NULL) {
+    lime_error("can not find window %d", e.window);
+    printf("can not find window\n");
+    return;
+  }
+
+  if (wm->grab_client == c) {
+    flush_paced_motion(wm);
+    if (wm->pace_armed) {
+      disarm_pace_timer(wm);
+    }
+  }
+
+  if (src == LIME_TITLE_BAR) {
+    c->on_drag = 0;
+    XUngrabPointer(wm->main_display, 0);
+  } else if (src == LIME_LSIDE) {
+    c->on_left_resize = 0;
+    XUngrabPointer(wm->main_display, 0);
+  } else if (src == LIME_RSIDE) {
     c->on_right_resize = 0;
     XUngrabPointer(wm->main_display, 0);
     printf("ButtonRelease c->on_right_resize = 0\n");
-  } else if (c->event_src == LIME_BSIDE) {
+  } else if (src == LIME_BSIDE) {
     c->on_bottom_resize = 0;
     XUngrabPointer(wm->main_display, 0);
   }
@@ -410,75 +1304,77 @@ static void on_button_release(XButtonEvent e, LimeWM *wm, XEvent *xe) {
     c->on_bottom_resize = c->on_left_resize = c->on_right_resize = c->on_drag =
         0;
   }
+  if (wm->grab_client == c) {
+    // the release may land on another part than the press did
+    XUngrabPointer(wm->main_display, 0);
+    wm->grab_client = NULL;
+    lime_info("grab released, %llu motion events coalesced so far",
+              (unsigned long long)wm->motion_coalesced);
+  }
 }
 
 static void process_button_press(LimeWM *wm, LimeClient *c, XButtonEvent e) {
   c->drag_src_posx = e.x_root;
   c->drag_src_posy = e.y_root;
 
-  int x_from, y_from;
-  Window return_root;
-  uint32_t width, height, border_width, depth;
-
-  XGetGeometry(wm->main_display, c->frame, &return_root, &x_from, &y_from,
-               &width, &height, &border_width, &depth);
-  c->frame_posx = x_from;
-  c->frame_posy = y_from;
-  c->frame_width = width;
-  c->frame_height = height;
-
-  XGetGeometry(wm->main_display, c->rightSide, &return_root, &x_from, &y_from,
-               &width, &height, &border_width, &depth);
-  c->rside_posx = x_from;
-  c->rside_posy = y_from;
-  c->rside_width = width;
-  c->rside_height = height;
-
-  XGetGeometry(wm->main_display, c->downSide, &return_root, &x_from, &y_from,
-               &width, &height, &border_width, &depth);
-  c->bside_posx = x_from;
-  c->bside_posy = y_from;
-  c->bside_width = width;
-  c->bside_height = height;
-
-  XGrabPointer(wm->main_display, c->title, 0,
+  // the cache is authoritative, starting a drag needs no round trip
+  c->drag_geom = client_geometry(wm, c, LIME_FRAME);
+  if (c->on_drag) {
+    // nothing else moves during the drag, the edges are sorted once, the
+    // top of the screen is where apply_motion clamps frames to
+    int screen = DefaultScreen(wm->main_display);
+    LimeGeometry area = {0, LIME_MIN_FRAME_Y,
+                         DisplayWidth(wm->main_display, screen),
+                         DisplayHeight(wm->main_display, screen) -
+                             LIME_MIN_FRAME_Y};
+    lime_snap_begin(&wm->snap, wm->geom_store, c->slot, &area);
+  }
+
+  wm->grab_client = c;
+  LIME_ROUND_TRIPS(wm, 1);
+  XGrabPointer(wm->main_display, grab_window(c), 0,
                PointerMotionMask | ButtonReleaseMask | ButtonPressMask,
                GrabModeAsync, GrabModeAsync, None, None, CurrentTime);
 }
 
 static void on_button_press(XButtonEvent e, LimeWM *wm, XEvent *xe) {
+  LimeEventSrc src;
   LimeClient *c = NULL;
   if (!(e.state & Mod1Mask)) {
-    c = get_client(e.window, wm);
+    c = get_pointer_client(wm, e.window, e.x, e.y, &src);
     // c = get_client_use_frame(e.window, wm);
+  } else if (e.window == wm->main_window) {
+    // Alt+drag anywhere in a frame moves it
+    c = client_at(wm, e.x_root, e.y_root);
+    src = LIME_TITLE_BAR;
   } else {
-    c = get_client(e.window, wm);
+    c = get_pointer_client(wm, e.window, e.x, e.y, &src);
   }
   if (c == NULL) {
     lime_info("can not find window %d", e.window);
     return;
   }
-  if (c->event_src == LIME_TITLE_BAR) {
+  if (src == LIME_TITLE_BAR) {
     c->on_drag = 1;
     process_button_press(wm, c, e);
-  } else if (c->event_src == LIME_LSIDE) {
+  } else if (src == LIME_LSIDE) {
     c->on_left_resize = 1;
     process_button_press(wm, c, e);
-  } else if (c->event_src == LIME_RSIDE) {
+  } else if (src == LIME_RSIDE) {
     c->on_right_resize = 1;
     process_button_press(wm, c, e);
     printf("c->on_right_resize = 1\n");
-  } else if (c->event_src == LIME_BSIDE) {
+  } else if (src == LIME_BSIDE) {
     c->on_bottom_resize = 1;
     process_button_press(wm, c, e);
   }
 
   if (c->on_drag == 1) {
-    printf("move frame post %d,%d | drag pos %d,%d\n", c->frame_posx,
-           c->frame_posy, c->drag_src_posx, c->drag_src_posy);
+    printf("move frame post %d,%d | drag pos %d,%d\n", c->drag_geom.x,
+           c->drag_geom.y, c->drag_src_posx, c->drag_src_posy);
   }
 
-  XRaiseWindow(wm->main_display, c->frame);
+  raise_client(wm, c);
   XSetInputFocus(wm->main_display, c->window, RevertToPointerRoot, CurrentTime);
   return;
   if (!(e.state & Mod1Mask)) {
@@ -486,68 +1382,190 @@ static void on_button_press(XButtonEvent e, LimeWM *wm, XEvent *xe) {
   }
 }
 
-void on_motion_notify(XMotionEvent e, LimeWM *wm) {
-  LimeClient *c = get_client(e.window, wm);
-  if (c == NULL) {
-    lime_error("motion can not find window %d", e.window);
-    printf("can not find window");
+/*
+ * while a drag or edge resize is in progress only the latest pointer position
+ * matters, drop the MotionNotify events queued right behind e for the grab
+ * window and keep the newest one in e, motion after a release or any other
+ * event stays queued so it is not folded into the drag
+ */
+static void coalesce_motion(LimeWM *wm, XEvent *e) {
+  LimeClient *c = wm->grab_client;
+  if (c == NULL || e->xmotion.window != grab_window(c)) {
+    return;
+  }
+  if (!(c->on_drag || c->on_right_resize || c->on_bottom_resize ||
+        c->on_left_resize)) {
     return;
   }
+  Window window = e->xmotion.window;
+  XEvent next;
+  while (XEventsQueued(wm->main_display, QueuedAlready) > 0) {
+    XPeekEvent(wm->main_display, &next);
+    if (next.type != MotionNotify || next.xmotion.window != window) {
+      break;
+    }
+    XNextEvent(wm->main_display, e);
+    wm->motion_coalesced++;
+  }
+}
 
-  int ep = XPending(wm->main_display);
+static void apply_motion(LimeWM *wm, LimeClient *c, int x_root, int y_root) {
+  const LimeGeometry *from = &c->drag_geom;
+  int deltax = x_root - c->drag_src_posx;
+  int deltay = y_root - c->drag_src_posy;
 
   if (c->on_drag == 1) {
-    int deltax = e.x_root - c->drag_src_posx;
-    int deltay = e.y_root - c->drag_src_posy;
-    int dstx = c->frame_posx + deltax;
-    int dsty = c->frame_posy + deltay;
-    // limit
-    if (dsty < 10) {
-      dsty = 10;
-    }
-    XMoveWindow(wm->main_display, c->frame, dstx, dsty);
+    int dstx = from->x + deltax;
+    int dsty = from->y + deltay;
+    lime_snap_apply(&wm->snap, &dstx, &dsty, from->width, from->height);
+    // limit, snapping already respects it
+    if (dsty < LIME_MIN_FRAME_Y) {
+      dsty = LIME_MIN_FRAME_Y;
+    }
+    configure_client(wm, c, dstx, dsty, from->width, from->height);
   } else if (c->on_right_resize == 1) {
-    int deltax = e.x_root - c->drag_src_posx;
-    int deltay = e.y_root - c->drag_src_posy;
+    int dstw = from->width + deltax;
+    if (dstw < LIME_MIN_FRAME_SIZE) {
+      dstw = LIME_MIN_FRAME_SIZE;
+    }
+    configure_client(wm, c, from->x, from->y, dstw, from->height);
+  } else if (c->on_bottom_resize == 1) {
+    int dsth = from->height + deltay;
+    if (dsth < LIME_MIN_FRAME_SIZE) {
+      dsth = LIME_MIN_FRAME_SIZE;
+    }
+    configure_client(wm, c, from->x, from->y, from->width, dsth);
+  }
+}
 
-    deltax = deltax > -c->frame_width ? deltax : c->frame_width;
-    deltay = deltay > -c->frame_height ? deltay : c->frame_height;
+static int paced_client(LimeWM *wm, LimeClient *c) {
+  return wm->move_mode == LIME_MOVE_PACED && c == wm->grab_client &&
+         (c->on_drag || c->on_right_resize || c->on_bottom_resize);
+}
 
-    int dstw = c->frame_width + deltax;
-    int dsth = c->frame_height;
+static void disarm_pace_timer(LimeWM *wm) {
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  timerfd_settime(wm->pace_fd, 0, &its, NULL);
+  wm->pace_armed = 0;
+}
 
-    int dstx = c->rside_posx + deltax;
-    int dsty = c->rside_posy;
+static void arm_pace_timer(LimeWM *wm) {
+  struct itimerspec its;
+  its.it_value.tv_sec = wm->pace_interval_ns / 1000000000L;
+  its.it_value.tv_nsec = wm->pace_interval_ns % 1000000000L;
+  its.it_interval = its.it_value;
+  timerfd_settime(wm->pace_fd, 0, &its, NULL);
+  wm->pace_armed = 1;
+}
 
-    XMoveWindow(wm->main_display, c->rightSide, dstx, dsty);
+static void flush_paced_motion(LimeWM *wm) {
+  LimeClient *c = wm->grab_client;
+  if (c == NULL || !c->motion_pending) {
+    return;
+  }
+  c->motion_pending = 0;
+  apply_motion(wm, c, c->pending_x_root, c->pending_y_root);
+}
 
-    XResizeWindow(wm->main_display, c->frame, dstw, dsth);
-    XResizeWindow(wm->main_display, c->window, dstw, dsth - 10);
-    XResizeWindow(wm->main_display, c->title, dstw, 10);
-    XResizeWindow(wm->main_display, c->downSide, dstw , dsth);
-  } else if (c->on_bottom_resize == 1) {
-    int deltax = e.x_root - c->drag_src_posx;
-    int deltay = e.y_root - c->drag_src_posy;
-    deltax = deltax > -c->frame_width ? deltax : c->frame_width;
-    deltay = deltay > -c->frame_height ? deltay : c->frame_height;
-    int dstw = c->frame_width;
-    int dsth = c->frame_height + deltay;
+/*
+ * called once per refresh interval while a paced drag is active, applies the
+ * newest pending position or stops the timer when the pointer stood still
+ */
+static void on_pace_timer(LimeWM *wm) {
+  uint64_t expirations = 0;
+  if (read(wm->pace_fd, &expirations, sizeof(expirations)) !=
+      sizeof(expirations)) {
+    return;
+  }
+  if (wm->grab_client && wm->grab_client->motion_pending) {
+    flush_paced_motion(wm);
+  } else {
+    disarm_pace_timer(wm);
+  }
+}
 
-    int dstx = c->bside_posx;
-    int dsty = c->bside_posy + deltay;
+void on_motion_notify(XMotionEvent e, LimeWM *wm) {
+  LimeClient *c = get_client(e.window, wm, NULL);
+  if (c == NULL) {
+    lime_error("motion can not find window %d", e.window);
+    printf("can not find window");
+    return;
+  }
 
-    XMoveWindow(wm->main_display, c->downSide, dstx, dsty);
-    XResizeWindow(wm->main_display, c->frame, dstw, dsth);
-    XResizeWindow(wm->main_display, c->window, dstw, dsth - 10);
-    XResizeWindow(wm->main_display, c->title, dstw, 10);
+  if (c != wm->grab_client && wm->decor_mode == LIME_DECOR_HITTEST) {
+    LimeEventSrc src;
+    if (get_pointer_client(wm, e.window, e.x, e.y, &src) == c) {
+      update_hover_cursor(wm, c, src);
+    }
+    return;
   }
 
-  return;
+  if (!paced_client(wm, c)) {
+    apply_motion(wm, c, e.x_root, e.y_root);
+    return;
+  }
+
+  c->pending_x_root = e.x_root;
+  c->pending_y_root = e.y_root;
+  c->motion_pending = 1;
+  if (!wm->pace_armed) {
+    // first step of a burst goes out at once, the rest wait for the timer
+    flush_paced_motion(wm);
+    arm_pace_timer(wm);
+  }
+}
+
+/*
+ * the focus ring is kept in most recently used order by on_focus_in, the
+ * first Alt+Tab selects the client behind the focused one and grabs the
+ * keyboard so that further Tabs and the Alt release reach lime, every step
+ * is one link away, the selection moves to the front when Alt is released
+ */
+static void cycle_focus(LimeWM *wm, int backward) {
+  LimeLink *head = &wm->focus_ring;
+  if (lime_link_empty(head)) {
+    return;
+  }
+  LimeLink *from = wm->cycle_client ? &wm->cycle_client->focus_link : head->next;
+  LimeLink *to = backward ? from->prev : from->next;
+  if (to == head) {
+    to = backward ? head->prev : head->next;
+  }
+  LimeClient *nc = lime_link_entry(to, LimeClient, focus_link);
+  raise_client(wm, nc);
+  XSetInputFocus(wm->main_display, nc->window, RevertToPointerRoot,
+                 CurrentTime);
+  if (wm->cycle_client == NULL) {
+    LIME_ROUND_TRIPS(wm, 1);
+    int status = XGrabKeyboard(wm->main_display, wm->main_window, 0,
+                               GrabModeAsync, GrabModeAsync, CurrentTime);
+    if (status != GrabSuccess) {
+      // no Alt release will arrive, make this a single step
+      lime_warin("Alt+Tab keyboard grab failed: %d", status);
+      lime_link_move_to_front(&wm->focus_ring, &nc->focus_link);
+      return;
+    }
+  }
+  wm->cycle_client = nc;
+}
+
+static void end_focus_cycle(LimeWM *wm) {
+  XUngrabKeyboard(wm->main_display, CurrentTime);
+  lime_link_move_to_front(&wm->focus_ring, &wm->cycle_client->focus_link);
+  wm->cycle_client = NULL;
+}
+
+static void on_key_release(XKeyEvent e, LimeWM *wm) {
+  if (wm->cycle_client && (e.keycode == wm->keycodes[LIME_KEY_ALT_L] ||
+                           e.keycode == wm->keycodes[LIME_KEY_ALT_R])) {
+    end_focus_cycle(wm);
+  }
 }
 
 void on_key_press(XKeyEvent e, LimeWM *wm) {
   if ((e.state & Mod1Mask && e.state & ControlMask &&
-       e.keycode == XKeysymToKeycode(wm->main_display, XK_T))) {
+       e.keycode == wm->keycodes[LIME_KEY_TERMINAL])) {
     printf("exec xterm\n");
 
     pid_t pid = fork();
@@ -555,6 +1573,10 @@ void on_key_press(XKeyEvent e, LimeWM *wm) {
     case -1:
       break;
     case 0: {
+      // signals handled through signalfd are blocked, do not leak that
+      sigset_t mask;
+      sigemptyset(&mask);
+      sigprocmask(SIG_SETMASK, &mask, NULL);
       int ret = execl("/usr/bin/xterm", "");
       if (ret != 0) {
         printf("exec error:%s\n", strerror(errno));
@@ -563,52 +1585,38 @@ void on_key_press(XKeyEvent e, LimeWM *wm) {
     }
   }
   if ((e.state & Mod1Mask) &&
-      (e.keycode == XKeysymToKeycode(wm->main_display, XK_F4))) {
-    Atom *supported_protocols;
-    int num_supported_protocols;
-    if (XGetWMProtocols(wm->main_display, e.window, &supported_protocols,
-                        &num_supported_protocols)) {
-      for (size_t i = 0; i < num_supported_protocols; i++) {
-        if (supported_protocols[i]) {
-          XEvent msg;
-          memset(&msg, 0, sizeof(msg));
-          msg.xclient.type = ClientMessage;
-          Atom WM_PROTOCOLS = XInternAtom(wm->main_display, "WM_PROTOCOLS", 0);
-          msg.xclient.message_type = WM_PROTOCOLS;
-          msg.xclient.window = e.window;
-          ;
-          msg.xclient.format = 32;
-          Atom WM_DELETE_WINDOW =
-              XInternAtom(wm->main_display, "WM_DELETE_WINDOW", 0);
-          msg.xclient.data.l[0] = WM_DELETE_WINDOW;
-          XSendEvent(wm->main_display, e.window, 0, 0, &msg);
-        }
-      }
-    } else {
-      XKillClient(wm->main_display, e.window);
+      (e.keycode == wm->keycodes[LIME_KEY_CLOSE])) {
+    // during the Alt+Tab keyboard grab keys are reported on the root, close
+    // the selected or else the focused client then
+    LimeClient *c = get_client(e.window, wm, NULL);
+    if (c == NULL) {
+      c = wm->cycle_client;
     }
-  } else if ((e.state & Mod1Mask) &&
-             (e.keycode == XKeysymToKeycode(wm->main_display, XK_Tab))) {
-    LimeListEntry *next;
-    LimeClient *c = get_client(e.window, wm);
-    for (LimeListEntry *cur = wm->clients->root; cur != NULL; cur = cur->next) {
-      if (cur->data == c) {
-        next = cur->next;
-        break;
-      }
+    if (c == NULL && !lime_link_empty(&wm->focus_ring)) {
+      c = lime_link_entry(wm->focus_ring.next, LimeClient, focus_link);
     }
-
-    if (next == NULL) {
-      next = wm->clients->root;
+    // WM_PROTOCOLS was read when the client got framed
+    if (c && (c->protocols & LIME_PROTOCOL_DELETE_WINDOW)) {
+      XEvent msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.xclient.type = ClientMessage;
+      msg.xclient.message_type = wm->atoms[LIME_ATOM_WM_PROTOCOLS];
+      msg.xclient.window = c->window;
+      msg.xclient.format = 32;
+      msg.xclient.data.l[0] = wm->atoms[LIME_ATOM_WM_DELETE_WINDOW];
+      msg.xclient.data.l[1] = CurrentTime;
+      XSendEvent(wm->main_display, c->window, 0, 0, &msg);
+    } else if (c) {
+      XKillClient(wm->main_display, c->window);
     }
-
-    LimeClient *nc = next->data;
-
-    XRaiseWindow(wm->main_display, nc->frame);
-    XSetInputFocus(wm->main_display, nc->window, RevertToPointerRoot,
-                   CurrentTime);
+  } else if ((e.state & Mod1Mask) &&
+             (e.keycode == wm->keycodes[LIME_KEY_CYCLE])) {
+    cycle_focus(wm, e.state & ShiftMask);
+  } else if ((e.state & Mod1Mask) &&
+             (e.keycode == wm->keycodes[LIME_KEY_LAYOUT])) {
+    switch_tile_mode(wm);
   } else if ((e.state & Mod1Mask && e.state & Mod2Mask) &&
-             (e.keycode == XKeysymToKeycode(wm->main_display, XK_t))) {
+             (e.keycode == wm->keycodes[LIME_KEY_TERMINAL_ALT])) {
     printf("IM HERE\n");
     execl("xterm", NULL);
   }
@@ -617,6 +1625,16 @@ void on_key_press(XKeyEvent e, LimeWM *wm) {
 void on_map_notify(XMapEvent e, LimeWM *wm) {}
 
 void on_focus_in(XFocusInEvent e, LimeWM *wm) {
+  // an Alt+Tab cycle reorders the ring once, when it ends
+  if (wm->cycle_client || e.mode == NotifyGrab || e.mode == NotifyUngrab ||
+      e.detail == NotifyPointer) {
+    return;
+  }
+  LimeEventSrc src;
+  LimeClient *c = get_client(e.window, wm, &src);
+  if (c && src == LIME_WINDOW) {
+    lime_link_move_to_front(&wm->focus_ring, &c->focus_link);
+  }
   //	XUngrabButton(
   //		wm->main_display,
   //		Button1,
@@ -639,139 +1657,876 @@ void on_focus_out(XFocusOutEvent e, LimeWM *wm) {
   //	);
 }
 void on_pointer_enter(XCrossingEvent e, LimeWM *wm) {
-  LimeClient *c = get_client(e.window, wm);
-  if (c->event_src == LIME_TITLE_BAR) {
-    Cursor cr = XCreateFontCursor(wm->main_display, XC_left_ptr);
-    XDefineCursor(wm->main_display, c->title, cr);
-  } else if (c->event_src == LIME_LSIDE) {
-    Cursor cr = XCreateFontCursor(wm->main_display, XC_sb_h_double_arrow);
-    XDefineCursor(wm->main_display, c->leftSide, cr);
-  } else if (c->event_src == LIME_RSIDE) {
-    Cursor cr = XCreateFontCursor(wm->main_display, XC_sb_h_double_arrow);
-    XDefineCursor(wm->main_display, c->rightSide, cr);
-  } else if (c->event_src == LIME_BSIDE) {
-    Cursor cr = XCreateFontCursor(wm->main_display, XC_sb_v_double_arrow);
-    XDefineCursor(wm->main_display, c->downSide, cr);
-  } else if (c->event_src == LIME_FRAME) {
-  } else if (c->event_src == LIME_WINDOW) {
+  LimeEventSrc src;
+  LimeClient *c = get_client(e.window, wm, &src);
+  if (c == NULL) {
+    return;
   }
+  if (src == LIME_FRAME && wm->decor_mode == LIME_DECOR_HITTEST) {
+    update_hover_cursor(wm, c, hit_test(wm, c, e.x, e.y));
+    return;
+  }
+  // decoration windows got their cursor once when they were created
 }
 
 void on_pointer_leave(XCrossingEvent e, LimeWM *wm) {
-  LimeClient *c = get_client(e.window, wm);
-  if (c->event_src == LIME_TITLE_BAR) {
+  LimeEventSrc src;
+  LimeClient *c = get_client(e.window, wm, &src);
+  if (c == NULL) {
+    return;
+  }
+  // the client inherits the frame cursor when it has none of its own, a
+  // resize arrow from the edge must not follow the pointer inside
+  if (src == LIME_FRAME && wm->decor_mode == LIME_DECOR_HITTEST &&
+      e.detail == NotifyInferior) {
+    update_hover_cursor(wm, c, LIME_FRAME);
+    return;
+  }
+  if (src == LIME_TITLE_BAR) {
     printf("@@@@@@@@@@@@@@@@@@@@@\n");
   } else {
     printf("**********************\n");
   }
 }
 
-void lime_window_manager_run(LimeWM *wm) {
+static const uint16_t EVENT_HANDLERS[LASTEvent] = {
+    [CreateNotify] = LIME_HANDLER_CREATE_NOTIFY,
+    [ConfigureRequest] = LIME_HANDLER_CONFIGURE_REQUEST,
+    [ConfigureNotify] = LIME_HANDLER_CONFIGURE_NOTIFY,
+    [MapNotify] = LIME_HANDLER_MAP_NOTIFY,
+    [DestroyNotify] = LIME_HANDLER_DESTROY_NOTIFY,
+    [ReparentNotify] = LIME_HANDLER_REPARENT_NOTIFY,
+    [MapRequest] = LIME_HANDLER_MAP_REQUEST,
+    [UnmapNotify] = LIME_HANDLER_UNMAP_NOTIFY,
+    [ButtonPress] = LIME_HANDLER_BUTTON_PRESS,
+    [ButtonRelease] = LIME_HANDLER_BUTTON_RELEASE,
+    [MotionNotify] = LIME_HANDLER_MOTION_NOTIFY,
+    [KeyPress] = LIME_HANDLER_KEY_PRESS,
+    [KeyRelease] = LIME_HANDLER_KEY_RELEASE,
+    [FocusIn] = LIME_HANDLER_FOCUS_IN,
+    [FocusOut] = LIME_HANDLER_FOCUS_OUT,
+    [EnterNotify] = LIME_HANDLER_POINTER_ENTER,
+    [LeaveNotify] = LIME_HANDLER_POINTER_LEAVE,
+    [Expose] = LIME_HANDLER_EXPOSE,
+    [MappingNotify] = LIME_HANDLER_MAPPING_NOTIFY,
+};
 
-  XGrabKey(wm->main_display, XKeysymToKeycode(wm->main_display, XK_t),
-           Mod1Mask | Mod2Mask, wm->main_window, 0, GrabModeAsync,
-           GrabModeAsync);
+static void trace_handler(LimeWM *wm, int event_type, int handler,
+                          uint64_t enter_ns, uint64_t exit_ns,
+                          unsigned long request) {
+  LimeTraceRecord record;
+  record.enter_ns = enter_ns;
+  record.exit_ns = exit_ns;
+  record.requests = NextRequest(wm->main_display) - request;
+  record.event_type = event_type;
+  record.handler = handler;
+  lime_trace_record(&record);
+}
+
+// requests are counted by the sequence number, replies at the call sites
+static void account_handler(LimeWM *wm, int handler, unsigned long request,
+                            uint64_t round_trips) {
+  LimeHandlerCost *cost = &wm->handler_costs[handler];
+  uint64_t requests = NextRequest(wm->main_display) - request;
+  uint64_t waited = wm->round_trips - round_trips;
+  cost->calls++;
+  cost->requests += requests;
+  cost->round_trips += waited;
+  if (requests > cost->max_requests) {
+    cost->max_requests = requests;
+  }
+  if (waited > cost->max_round_trips) {
+    cost->max_round_trips = waited;
+  }
+}
+
+static int compare_handler_cost(const void *a, const void *b) {
+  const LimeHandlerCost *x = *(const LimeHandlerCost *const *)a;
+  const LimeHandlerCost *y = *(const LimeHandlerCost *const *)b;
+  if (x->round_trips != y->round_trips) {
+    return x->round_trips < y->round_trips ? 1 : -1;
+  }
+  if (x->requests != y->requests) {
+    return x->requests < y->requests ? 1 : -1;
+  }
+  return 0;
+}
+
+void lime_window_manager_dump_round_trips(LimeWM *wm) {
+  LimeHandlerCost *sorted[LIME_HANDLER_COUNT];
+  int n = 0;
+  for (int i = 0; i < LIME_HANDLER_COUNT; i++) {
+    if (wm->handler_costs[i].calls > 0) {
+      sorted[n++] = &wm->handler_costs[i];
+    }
+  }
+  qsort(sorted, n, sizeof(sorted[0]), compare_handler_cost);
+
+  fprintf(stderr, "%-22s %8s %10s %8s %8s %10s %8s\n", "handler", "calls",
+          "requests", "max", "per call", "replies", "max");
+  for (int i = 0; i < n; i++) {
+    const LimeHandlerCost *cost = sorted[i];
+    const char *name = lime_handler_name(cost - wm->handler_costs);
+    fprintf(stderr, "%-22s %8llu %10llu %8llu %8.2f %10llu %8llu\n", name,
+            (unsigned long long)cost->calls,
+            (unsigned long long)cost->requests,
+            (unsigned long long)cost->max_requests,
+            (double)cost->requests / cost->calls,
+            (unsigned long long)cost->round_trips,
+            (unsigned long long)cost->max_round_trips);
+    if (cost->round_trips > 0) {
+      lime_info("%s waited for %llu replies in %llu calls", name,
+                (unsigned long long)cost->round_trips,
+                (unsigned long long)cost->calls);
+    }
+  }
+
+  fprintf(stderr, "blocking replies by annotated call site:\n");
+  for (LimeRoundTripSite *site = lime_round_trip_sites; site != NULL;
+       site = site->next) {
+    fprintf(stderr, "  %-28s line %-5d %10llu\n", site->func, site->line,
+            (unsigned long long)site->count);
+  }
+}
+
+// the field holding the window an event is about when that is not xany.window
+static Window *event_subject(XEvent *e) {
+  switch (e->type) {
+  case CreateNotify:
+    return &e->xcreatewindow.window;
+  case DestroyNotify:
+    return &e->xdestroywindow.window;
+  case UnmapNotify:
+    return &e->xunmap.window;
+  case MapNotify:
+    return &e->xmap.window;
+  case MapRequest:
+    return &e->xmaprequest.window;
+  case ReparentNotify:
+    return &e->xreparent.window;
+  case ConfigureNotify:
+    return &e->xconfigure.window;
+  case ConfigureRequest:
+    return &e->xconfigurerequest.window;
+  default:
+    return NULL;
+  }
+}
+
+static LimeRecordRef record_ref(LimeWM *wm, Window w) {
+  LimeRecordRef ref = {0};
+  LimeEventSrc src;
+  LimeClient *c;
+  if (w == None) {
+    ref.src = LIME_RECORD_NONE;
+  } else if (w == wm->main_window) {
+    ref.src = LIME_RECORD_ROOT;
+  } else if ((c = get_client(w, wm, &src)) != NULL) {
+    ref.client = c->window;
+    ref.src = src;
+  } else {
+    // not framed (yet), the window is its own client
+    ref.client = w;
+    ref.src = LIME_WINDOW;
+  }
+  return ref;
+}
+
+static void record_event(LimeWM *wm, XEvent *e) {
+  LimeRecordEvent record;
+  memset(&record, 0, sizeof(record));
+  record.event = *e;
+  record.window = record_ref(wm, e->xany.window);
+  Window *subject = event_subject(e);
+  record.subject = record_ref(wm, subject ? *subject : None);
+  lime_record_write(&record);
+}
+
+/*
+ * clients adopted at startup never produced a CreateNotify/MapRequest, give
+ * the recording a pair for each of them so a replay frames them too
+ */
+static void record_existing_clients(LimeWM *wm) {
+  lime_link_for_each(link, &wm->clients) {
+    LimeClient *c = lime_link_entry(link, LimeClient, link);
+    XEvent e;
+    memset(&e, 0, sizeof(e));
+    e.xcreatewindow.type = CreateNotify;
+    e.xcreatewindow.parent = wm->main_window;
+    e.xcreatewindow.window = c->window;
+    e.xcreatewindow.x = wm->geom_store->x[c->slot];
+    e.xcreatewindow.y = wm->geom_store->y[c->slot];
+    e.xcreatewindow.width = c->geom[LIME_WINDOW].width;
+    e.xcreatewindow.height = c->geom[LIME_WINDOW].height;
+    record_event(wm, &e);
+  }
+  lime_link_for_each(link, &wm->clients) {
+    LimeClient *c = lime_link_entry(link, LimeClient, link);
+    XEvent e;
+    memset(&e, 0, sizeof(e));
+    e.xmaprequest.type = MapRequest;
+    e.xmaprequest.parent = wm->main_window;
+    e.xmaprequest.window = c->window;
+    record_event(wm, &e);
+  }
+}
+
+static void dispatch_event(LimeWM *wm, XEvent *e) {
+  lime_info("event: %s", ToString(*e));
+  // a burst of drag motion is handled as its newest event, record that one
+  // so a replay moves frames exactly like the live run did
+  if (e->type == MotionNotify) {
+    coalesce_motion(wm, e);
+  }
+  if (lime_record_enabled) {
+    record_event(wm, e);
+  }
+  uint64_t round_trips = wm->round_trips;
+  unsigned long request = NextRequest(wm->main_display);
+  uint64_t enter_ns = 0;
+  if (LIME_TIME_EVENTS || lime_trace_enabled) {
+    enter_ns = lime_trace_now();
+  }
+
+  switch (e->type) {
+  case CreateNotify:
+    on_create_notify(e->xcreatewindow, wm);
+    break;
+
+  case ConfigureRequest:
+    on_configure_request(e->xconfigurerequest, wm);
+    break;
+
+  case ConfigureNotify:
+    on_configure_notify(e->xconfigure, wm);
+    break;
+
+  case MapNotify:
+    printf("Map notify\n");
+    on_map_notify(e->xmap, wm);
+    break;
+
+  case DestroyNotify:
+    on_destroy_notify(e->xdestroywindow);
+    break;
+
+  case ReparentNotify:
+    on_reparent_notify(e->xreparent);
+    break;
+
+  case MapRequest:
+    on_map_request(e->xmaprequest, wm);
+    break;
+
+  case UnmapNotify:
+    on_unmap_notify(e->xunmap, wm);
+    break;
+
+  case ButtonPress:
+    on_button_press(e->xbutton, wm, e);
+    break;
+
+  case ButtonRelease:
+    printf("Button release\n");
+    on_button_release(e->xbutton, wm, e);
+    break;
+
+  case MotionNotify:
+    on_motion_notify(e->xmotion, wm);
+    break;
+
+  case KeyPress:
+    printf("key press\n");
+    on_key_press(e->xkey, wm);
+    break;
+
+  case KeyRelease:
+    on_key_release(e->xkey, wm);
+    break;
+
+  case FocusIn:
+    on_focus_in(e->xfocus, wm);
+    break;
+
+  case FocusOut:
+    on_focus_out(e->xfocus, wm);
+    break;
+
+  case EnterNotify:
+    on_pointer_enter(e->xcrossing, wm);
+    break;
+
+  case LeaveNotify:
+    on_pointer_leave(e->xcrossing, wm);
+    break;
+
+  case Expose:
+    on_expose(e->xexpose, wm);
+    break;
+
+  case MappingNotify:
+    on_mapping_notify(e->xmapping, wm);
+    break;
+
+  default:
+    lime_info("ignored event: %s", ToString(*e));
+    // lime_info("ignored event", NULL);
+    break;
+  }
+
+  int handler = e->type < LASTEvent ? EVENT_HANDLERS[e->type] : 0;
+  account_handler(wm, handler, request, round_trips);
+  if (wm->round_trips != round_trips) {
+    lime_info("event %s waited for %llu round trips", ToString(*e),
+              (unsigned long long)(wm->round_trips - round_trips));
+  }
+  if (!LIME_TIME_EVENTS && !lime_trace_enabled) {
+    return;
+  }
+  uint64_t exit_ns = lime_trace_now();
+#ifdef LIME_HISTOGRAM
+  if (e->type < LASTEvent) {
+    lime_histogram_add(&wm->latency[e->type], exit_ns - enter_ns);
+  }
+#endif
+  if (lime_trace_enabled) {
+    trace_handler(wm, e->type, handler, enter_ns, exit_ns, request);
+  }
+}
+
+void lime_window_manager_dump_latency(LimeWM *wm) {
+#ifdef LIME_HISTOGRAM
+  fprintf(stderr, "%-18s %10s %10s %10s %10s\n", "event", "count", "p50 us",
+          "p99 us", "max us");
+  for (int type = 0; type < LASTEvent; type++) {
+    const LimeHistogram *h = &wm->latency[type];
+    if (h->count == 0) {
+      continue;
+    }
+    double p50 = lime_histogram_percentile(h, 50) / 1e3;
+    double p99 = lime_histogram_percentile(h, 99) / 1e3;
+    double max = h->max / 1e3;
+    fprintf(stderr, "%-18s %10llu %10.1f %10.1f %10.1f\n",
+            lime_event_name(type), (unsigned long long)h->count, p50, p99, max);
+    lime_info("latency %s count %llu p50 %.1f us p99 %.1f us max %.1f us",
+              lime_event_name(type), (unsigned long long)h->count, p50, p99,
+              max);
+  }
+#else
+  fprintf(stderr, "latency histograms are not compiled in\n");
+#endif
+}
+
+void lime_window_manager_dump_geometry(LimeWM *wm) {
+  static const char *const names[] = {
+      [LIME_TITLE_BAR] = "title",  [LIME_LSIDE] = "left",
+      [LIME_RSIDE] = "right",      [LIME_BSIDE] = "bottom",
+      [LIME_LCORNER] = "lcorner",  [LIME_RCORNER] = "rcorner",
+      [LIME_FRAME] = "frame",      [LIME_WINDOW] = "window",
+  };
+  lime_link_for_each(link, &wm->clients) {
+    LimeClient *c = lime_link_entry(link, LimeClient, link);
+    fprintf(stderr, "client %lu\n", c->window);
+    for (int src = 0; src <= LIME_WINDOW; src++) {
+      Window w = client_window(c, src);
+      if (w == None) {
+        continue;
+      }
+      const LimeGeometry g = client_geometry(wm, c, src);
+      fprintf(stderr, "  %-8s %-10lu %5d,%-5d %5dx%-5d\n", names[src], w, g.x,
+              g.y, g.width, g.height);
+    }
+  }
+}
+
+static LimeSource *find_source(LimeWM *wm, int fd) {
+  for (LimeListEntry *entry = wm->sources->root; entry != NULL;
+       entry = entry->next) {
+    LimeSource *source = entry->data;
+    if (source->fd == fd) {
+      return source;
+    }
+  }
+  return NULL;
+}
+
+int lime_window_manager_add_source(LimeWM *wm, int fd, uint32_t events,
+                                   LimeSourceFunc func, void *udata) {
+  if (fd < 0 || func == NULL || find_source(wm, fd) != NULL) {
+    return -1;
+  }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.fd = fd;
+  if (epoll_ctl(wm->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    lime_error("epoll add fd %d error: %s", fd, strerror(errno));
+    return -1;
+  }
+  LimeSource *source = lime_mallocz(sizeof(*source));
+  source->fd = fd;
+  source->events = events;
+  source->func = func;
+  source->udata = udata;
+  lime_list_add(wm->sources, source);
+  return 0;
+}
+
+void lime_window_manager_remove_source(LimeWM *wm, int fd) {
+  LimeSource *source = find_source(wm, fd);
+  if (source == NULL) {
+    return;
+  }
+  epoll_ctl(wm->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+  lime_list_del(wm->sources, source);
+  lime_free(source);
+}
+
+int lime_window_manager_add_timer(LimeWM *wm, long interval_ms,
+                                  LimeSourceFunc func, void *udata) {
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0) {
+    lime_error("timerfd_create error: %s", strerror(errno));
+    return -1;
+  }
+  struct itimerspec its;
+  its.it_value.tv_sec = interval_ms / 1000;
+  its.it_value.tv_nsec = (interval_ms % 1000) * 1000000L;
+  its.it_interval = its.it_value;
+  if (timerfd_settime(fd, 0, &its, NULL) < 0 ||
+      lime_window_manager_add_source(wm, fd, EPOLLIN, func, udata) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void process_x_events(LimeWM *wm) {
+  int n = XEventsQueued(wm->main_display, QueuedAfterReading);
+  if (n > LIME_EVENT_BATCH) {
+    // leave the rest for the next round so other sources are not starved
+    n = LIME_EVENT_BATCH;
+  }
+  for (int i = 0; i < n && !wm->exit; i++) {
+    XEvent e;
+    XNextEvent(wm->main_display, &e);
+    dispatch_event(wm, &e);
+  }
+}
+
+static void on_x_source(LimeWM *wm, int fd, uint32_t events, void *udata) {
+  process_x_events(wm);
+}
+
+static void on_pace_source(LimeWM *wm, int fd, uint32_t events, void *udata) {
+  uint64_t round_trips = wm->round_trips;
+  unsigned long request = NextRequest(wm->main_display);
+  uint64_t enter_ns = lime_trace_enabled ? lime_trace_now() : 0;
+  on_pace_timer(wm);
+  account_handler(wm, LIME_HANDLER_PACE_TIMER, request, round_trips);
+  if (lime_trace_enabled) {
+    trace_handler(wm, LIME_TRACE_TIMER_EVENT, LIME_HANDLER_PACE_TIMER,
+                  enter_ns, lime_trace_now(), request);
+  }
+}
+
+static void on_signal_source(LimeWM *wm, int fd, uint32_t events,
+                             void *udata) {
+  struct signalfd_siginfo info;
+  while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+    switch (info.ssi_signo) {
+    case SIGCHLD:
+      while (waitpid(-1, NULL, WNOHANG) > 0) {
+      }
+      break;
+    case SIGINT:
+    case SIGTERM:
+    case SIGHUP:
+      lime_info("got signal %d, exit", info.ssi_signo);
+      lime_window_manager_exit(wm);
+      break;
+    case SIGUSR1:
+      lime_window_manager_dump_latency(wm);
+      lime_window_manager_dump_round_trips(wm);
+      lime_slab_dump_stats(stderr);
+      dump_frame_pool(wm);
+      lime_mem_report(stderr);
+      break;
+    case SIGUSR2:
+      lime_window_manager_dump_geometry(wm);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static double elapsed_ms(const struct timespec *from,
+                         const struct timespec *to) {
+  return (to->tv_sec - from->tv_sec) * 1000.0 +
+         (to->tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+/*
+ * frame every viewable top level window that existed before lime started,
+ * attributes and protocols of all of them are fetched in one pipelined pass
+ * and the frames are created without further round trips, so the server is
+ * only grabbed for the tree query, one batch of replies and the reparenting
+ */
+static void adopt_existing_windows(LimeWM *wm) {
+  struct timespec start, grabbed, ungrabbed, done;
+  clock_gettime(CLOCK_MONOTONIC, &start);
 
   XGrabServer(wm->main_display);
+  clock_gettime(CLOCK_MONOTONIC, &grabbed);
 
   Window root, parent;
-  Window *topwindows;
-  uint32_t nums;
+  Window *topwindows = NULL;
+  uint32_t nums = 0;
   XQueryTree(wm->main_display, wm->main_window, &root, &parent, &topwindows,
              &nums);
-  for (size_t i = 0; i < nums; i++) {
-    frame(topwindows[i], wm, 1);
+  LIME_ROUND_TRIPS(wm, 1);
+
+  size_t adopted = 0;
+  if (nums > 0) {
+    LimeWindowInfo *infos = lime_malloc(sizeof(*infos) * nums);
+    // adopted frames keep their position, no hints needed for placement
+    fetch_window_info(wm, topwindows, infos, nums, 0);
+    for (size_t i = 0; i < nums; i++) {
+      if (infos[i].valid && !infos[i].override_redirect &&
+          infos[i].map_state == IsViewable) {
+        frame_with_info(topwindows[i], wm, &infos[i], 1);
+        adopted++;
+      }
+    }
+    lime_free(infos);
   }
+  tile_clients(wm);
 
-  XFree(topwindows);
   XUngrabServer(wm->main_display);
+  XFlush(wm->main_display);
+  clock_gettime(CLOCK_MONOTONIC, &ungrabbed);
 
-  while (!wm->exit) {
-    XEvent e;
-    XNextEvent(wm->main_display, &e);
-    lime_info("event: %s", ToString(e));
+  if (topwindows) {
+    XFree(topwindows);
+  }
+  // wait for the server to finish the batch so the timing is honest
+  XSync(wm->main_display, 0);
+  clock_gettime(CLOCK_MONOTONIC, &done);
 
-    switch (e.type) {
-    case CreateNotify:
-      on_create_notify(e.xcreatewindow, wm);
-      break;
+  lime_info("adopted %zu of %u windows in %.3f ms, server grabbed %.3f ms",
+            adopted, nums, elapsed_ms(&start, &done),
+            elapsed_ms(&grabbed, &ungrabbed));
+}
 
-    case ConfigureRequest:
-      on_configure_request(e.xconfigurerequest, wm);
-      break;
+static int init_sources(LimeWM *wm) {
+  wm->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (wm->epoll_fd < 0) {
+    lime_error("epoll_create1 error: %s", strerror(errno));
+    return -1;
+  }
 
-    case ConfigureNotify:
-      printf("configure notify\n");
-      break;
+  if (lime_window_manager_add_source(wm, ConnectionNumber(wm->main_display),
+                                     EPOLLIN, on_x_source, NULL) < 0) {
+    return -1;
+  }
 
-    case MapNotify:
-      printf("Map notify\n");
-      on_map_notify(e.xmap, wm);
-      break;
+  if (wm->pace_fd >= 0) {
+    lime_window_manager_add_source(wm, wm->pace_fd, EPOLLIN, on_pace_source,
+                                   NULL);
+  }
 
-    case DestroyNotify:
-      on_destroy_notify(e.xdestroywindow);
-      break;
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGHUP);
+  sigaddset(&mask, SIGCHLD);
+  sigaddset(&mask, SIGUSR1);
+  sigaddset(&mask, SIGUSR2);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+  wm->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (wm->signal_fd < 0) {
+    lime_error("signalfd error: %s", strerror(errno));
+    return -1;
+  }
+  return lime_window_manager_add_source(wm, wm->signal_fd, EPOLLIN,
+                                        on_signal_source, NULL);
+}
 
-    case ReparentNotify:
-      on_reparent_notify(e.xreparent);
-      break;
+// wait up to timeout ms for sources and run them, returns how many were ready
+static int poll_sources(LimeWM *wm, int timeout) {
+  struct epoll_event events[LIME_MAX_SOURCES];
+  int n = epoll_wait(wm->epoll_fd, events, LIME_MAX_SOURCES, timeout);
+  if (n < 0) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    lime_error("epoll_wait error: %s", strerror(errno));
+    return -1;
+  }
+  for (int i = 0; i < n && !wm->exit; i++) {
+    LimeSource *source = find_source(wm, events[i].data.fd);
+    if (source) {
+      source->func(wm, source->fd, events[i].events, source->udata);
+    }
+  }
+  return n;
+}
 
-    case MapRequest:
-      on_map_request(e.xmaprequest, wm);
-      break;
+void lime_window_manager_run(LimeWM *wm) {
 
-    case UnmapNotify:
-      on_unmap_notify(e.xunmap, wm);
-      break;
+  adopt_existing_windows(wm);
+  if (lime_record_enabled) {
+    record_existing_clients(wm);
+  }
 
-    case ButtonPress:
-      on_button_press(e.xbutton, wm, &e);
+  while (!wm->exit) {
+    XFlush(wm->main_display);
+    // events already read into the Xlib queue do not wake up epoll
+    int queued = XEventsQueued(wm->main_display, QueuedAlready);
+    int n = poll_sources(wm, queued > 0 ? 0 : -1);
+    if (n < 0) {
       break;
+    }
+    if (n == 0) {
+      process_x_events(wm);
+    }
+  }
+}
 
-    case ButtonRelease:
-      printf("Button release\n");
-      on_button_release(e.xbutton, wm, &e);
-      break;
+typedef struct lime_replay_stat {
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+} LimeReplayStat;
+
+#define LIME_REPLAY_WIDTH 320
+#define LIME_REPLAY_HEIGHT 240
+
+/*
+ * recorded client windows are stood in for by synthetic windows created on
+ * first sight, sized from the recorded CreateNotify when there is one
+ */
+static Window replay_window(LimeWM *wm, LimeMap *remap, LimeRecordRef ref,
+                            XEvent *e) {
+  if (ref.src == LIME_RECORD_NONE) {
+    return None;
+  }
+  if (ref.src == LIME_RECORD_ROOT) {
+    return wm->main_window;
+  }
+  Window w;
+  LimeMapEntry *entry = lime_map_get(remap, ref.client);
+  if (entry) {
+    w = (Window)(uintptr_t)entry->data;
+  } else {
+    int x = 0, y = 0;
+    unsigned int width = LIME_REPLAY_WIDTH, height = LIME_REPLAY_HEIGHT;
+    if (e->type == CreateNotify && e->xcreatewindow.width > 0 &&
+        e->xcreatewindow.height > 0) {
+      x = e->xcreatewindow.x;
+      y = e->xcreatewindow.y;
+      width = e->xcreatewindow.width;
+      height = e->xcreatewindow.height;
+    }
+    w = XCreateSimpleWindow(wm->main_display, wm->main_window, x, y, width,
+                            height, 0, 0,
+                            WhitePixel(wm->main_display,
+                                       DefaultScreen(wm->main_display)));
+    lime_map_put(remap, ref.client, (void *)(uintptr_t)w, 0);
+  }
+  if (ref.src == LIME_WINDOW) {
+    return w;
+  }
+  LimeClient *c = get_client(w, wm, NULL);
+  if (c == NULL) {
+    return None;
+  }
+  return client_window(c, ref.src);
+}
 
-    case MotionNotify:
-      // while (XCheckTypedWindowEvent(
-      //  wm->main_display,
-      //  e.xmotion.window,
-      //  MotionNotify, &e))
-      //{
-      // }
-      on_motion_notify(e.xmotion, wm);
-
-    case KeyPress:
-      printf("key press\n");
-      on_key_press(e.xkey, wm);
-      break;
+// rewrite the window ids of a recorded event, -1 when it can not be replayed
+static int replay_remap(LimeWM *wm, LimeMap *remap, LimeRecordEvent *record) {
+  XEvent *e = &record->event;
+  e->xany.display = wm->main_display;
+  e->xany.send_event = 0;
+  // stale serials would be dropped by on_configure_notify
+  e->xany.serial = NextRequest(wm->main_display);
+
+  Window *subject = event_subject(e);
+  if (subject) {
+    *subject = replay_window(wm, remap, record->subject, e);
+    if (*subject == None) {
+      return -1;
+    }
+  }
+  e->xany.window = replay_window(wm, remap, record->window, e);
+  if (e->xany.window == None && e->type != MappingNotify) {
+    return -1;
+  }
 
-    case FocusIn:
-      on_focus_in(e.xfocus, wm);
-      break;
+  switch (e->type) {
+  case KeyPress:
+  case KeyRelease:
+    e->xkey.root = wm->main_window;
+    e->xkey.subwindow = None;
+    break;
+  case ButtonPress:
+  case ButtonRelease:
+    e->xbutton.root = wm->main_window;
+    e->xbutton.subwindow = None;
+    break;
+  case MotionNotify:
+    e->xmotion.root = wm->main_window;
+    e->xmotion.subwindow = None;
+    break;
+  case EnterNotify:
+  case LeaveNotify:
+    e->xcrossing.root = wm->main_window;
+    e->xcrossing.subwindow = None;
+    break;
+  case ConfigureRequest:
+    // the sibling is not part of the recording
+    e->xconfigurerequest.above = None;
+    e->xconfigurerequest.value_mask &= ~(CWSibling | CWStackMode);
+    break;
+  }
+  return 0;
+}
 
-    case FocusOut:
-      on_focus_out(e.xfocus, wm);
-      break;
+static void replay_report(LimeReplayStat *stats, size_t replayed,
+                          size_t skipped, uint64_t total_ns,
+                          uint64_t wall_ns) {
+  fprintf(stderr, "replayed %zu events (%zu skipped) in %.3f ms, handlers "
+                  "%.3f ms\n",
+          replayed, skipped, wall_ns / 1e6, total_ns / 1e6);
+  fprintf(stderr, "%-18s %8s %12s %12s %12s\n", "event", "count", "mean us",
+          "max us", "total ms");
+  for (int type = 0; type < LASTEvent; type++) {
+    LimeReplayStat *stat = &stats[type];
+    if (stat->count == 0) {
+      continue;
+    }
+    fprintf(stderr, "%-18s %8llu %12.3f %12.3f %12.3f\n",
+            lime_event_name(type), (unsigned long long)stat->count,
+            stat->total_ns / 1e3 / stat->count, stat->max_ns / 1e3,
+            stat->total_ns / 1e6);
+  }
+  lime_info("replayed %zu events (%zu skipped), handlers %.3f ms", replayed,
+            skipped, total_ns / 1e6);
+}
 
-    case EnterNotify:
-      on_pointer_enter(e.xcrossing, wm);
-      break;
+int lime_window_manager_replay(LimeWM *wm, const char *path) {
+  FILE *file = lime_record_open_read(path);
+  if (file == NULL) {
+    lime_error("%s is not a lime recording", path);
+    return -1;
+  }
+  const char *fast = getenv("LIME_REPLAY_FAST");
+  int realtime = !(fast && strcmp(fast, "1") == 0);
+
+  // the recording is the only input, live events are dropped between
+  // records so the handlers never see the synthetic windows twice
+  lime_window_manager_remove_source(wm, ConnectionNumber(wm->main_display));
+
+  LimeMap *remap = lime_map_create();
+  LimeReplayStat stats[LASTEvent];
+  memset(stats, 0, sizeof(stats));
+  size_t replayed = 0, skipped = 0;
+  uint64_t total_ns = 0;
+  uint64_t start = lime_trace_now();
+
+  LimeRecordEvent record;
+  while (!wm->exit && lime_record_read(file, &record) == 0) {
+    // keep the pace timer and signals running while waiting for the record
+    uint64_t now;
+    while (realtime && (now = lime_trace_now()) < start + record.time_ns) {
+      uint64_t wait_ns = start + record.time_ns - now;
+      if (poll_sources(wm, (int)((wait_ns + 999999) / 1000000)) < 0) {
+        break;
+      }
+    }
+    if (!realtime) {
+      poll_sources(wm, 0);
+    }
 
-    case LeaveNotify:
-      on_pointer_leave(e.xcrossing, wm);
-      break;
+    int type = record.event.type;
+    if (type < KeyPress || type >= LASTEvent ||
+        replay_remap(wm, remap, &record) < 0) {
+      skipped++;
+      continue;
+    }
 
-    default:
-      lime_info("ignored event: %s", ToString(e));
-      // lime_info("ignored event", NULL);
-      break;
+    uint64_t enter = lime_trace_now();
+    dispatch_event(wm, &record.event);
+    uint64_t elapsed = lime_trace_now() - enter;
+
+    LimeReplayStat *stat = &stats[type];
+    stat->count++;
+    stat->total_ns += elapsed;
+    if (elapsed > stat->max_ns) {
+      stat->max_ns = elapsed;
     }
+    total_ns += elapsed;
+    replayed++;
+
+    if (type == DestroyNotify && record.subject.src == LIME_WINDOW) {
+      XDestroyWindow(wm->main_display, record.event.xdestroywindow.window);
+      lime_map_del(remap, record.subject.client);
+    }
+    XSync(wm->main_display, True);
   }
+  // let a pending paced move land
+  flush_paced_motion(wm);
+  XSync(wm->main_display, True);
+
+  replay_report(stats, replayed, skipped, total_ns, lime_trace_now() - start);
+  fclose(file);
+  lime_map_destory(remap);
+  return 0;
 }
 
 void lime_window_manager_exit(LimeWM *wm) { wm->exit = 1; }
 
-void lime_window_manager_destroy(LimeWM *wm) {}
+void lime_window_manager_destroy(LimeWM *wm) {
+  if (wm == NULL) {
+    return;
+  }
+#ifdef LIME_HISTOGRAM
+  lime_window_manager_dump_latency(wm);
+  lime_free(wm->latency);
+#endif
+  lime_window_manager_dump_round_trips(wm);
+  while (wm->sources->root != NULL) {
+    LimeSource *source = wm->sources->root->data;
+    lime_window_manager_remove_source(wm, source->fd);
+  }
+  lime_list_destory(wm->sources);
+  if (wm->signal_fd >= 0) {
+    close(wm->signal_fd);
+  }
+  if (wm->pace_fd >= 0) {
+    close(wm->pace_fd);
+  }
+  if (wm->epoll_fd >= 0) {
+    close(wm->epoll_fd);
+  }
+  if (wm->main_display) {
+    XCloseDisplay(wm->main_display);
+  }
+  lime_map_destory(wm->windows);
+  lime_slab_dump_stats(stderr);
+  dump_frame_pool(wm);
+  // the tile nodes live in the clients
+  lime_tile_release(&wm->tile);
+  lime_slab_cache_destory(wm->client_cache);
+  lime_geom_store_destory(wm->geom_store);
+  lime_spatial_destory(wm->spatial);
+  lime_snap_release(&wm->snap);
+  lime_place_release(&wm->place);
+  lime_free(wm->monitors);
+  lime_free(wm);
+  lime_record_close();
+  lime_trace_close();
+}
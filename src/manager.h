@@ -1,8 +1,18 @@
 #ifndef __LIME_MANAGER_H__
 #define __LIME_MANAGER_H__
 
+#include "geometry.h"
+#include "histogram.h"
 #include "list.h"
+#include "map.h"
+#include "place.h"
+#include "snap.h"
+#include "spatial.h"
+#include "mem.h"
+#include "tile.h"
+#include "trace.h"
 #include <X11/Xlib.h>
+#include <stdint.h>
 
 typedef enum lime_event_src {
   LIME_TITLE_BAR,
@@ -15,7 +25,53 @@ typedef enum lime_event_src {
   LIME_WINDOW,
 } LimeEventSrc;
 
+typedef enum lime_move_mode {
+  LIME_MOVE_IMMEDIATE, // reconfigure on every processed motion event
+  LIME_MOVE_PACED,     // at most one reconfigure per screen refresh
+} LimeMoveMode;
+
+typedef enum lime_atom {
+  LIME_ATOM_WM_PROTOCOLS,
+  LIME_ATOM_WM_DELETE_WINDOW,
+  LIME_ATOM_COUNT,
+} LimeAtom;
+
+// key bindings, their keycodes are cached in LimeWM.keycodes
+typedef enum lime_key {
+  LIME_KEY_TERMINAL,     // Alt+Ctrl+T
+  LIME_KEY_TERMINAL_ALT, // Alt+NumLock+t
+  LIME_KEY_CLOSE,        // Alt+F4
+  LIME_KEY_CYCLE,        // Alt+Tab
+  LIME_KEY_LAYOUT,       // Alt+Space switches the tiling mode
+  LIME_KEY_ALT_L,        // releasing Alt ends an Alt+Tab cycle
+  LIME_KEY_ALT_R,
+  LIME_KEY_COUNT,
+} LimeKey;
+
+typedef enum lime_cursor {
+  LIME_CURSOR_NORMAL,
+  LIME_CURSOR_H_RESIZE,
+  LIME_CURSOR_V_RESIZE,
+  LIME_CURSOR_BL_CORNER,
+  LIME_CURSOR_BR_CORNER,
+  LIME_CURSOR_COUNT,
+} LimeCursor;
+
+typedef enum lime_decor_mode {
+  LIME_DECOR_WINDOWS, // title and sides are child windows of the frame
+  LIME_DECOR_HITTEST, // decorations are painted, the frame hit-tests input
+} LimeDecorMode;
+
+#define LIME_TITLE_HEIGHT 10
+#define LIME_SIDE_WIDTH 2
+
+// WM_PROTOCOLS a client advertised when it was framed
+#define LIME_PROTOCOL_DELETE_WINDOW (1 << 0)
+
 typedef struct lime_client {
+  LimeLink link; // in wm->clients
+  LimeLink focus_link; // in wm->focus_ring
+  LimeTileNode tile; // in a column of wm->tile
   Window window;
   Window frame;
   Window title;
@@ -24,21 +80,14 @@ typedef struct lime_client {
   Window rightSide;
   Window downLeftCorner;
   Window downRightCorner;
-  LimeEventSrc event_src;
-  int frame_posx;
-  int frame_posy;
-  int frame_width;
-  int frame_height;
-
-  int rside_posx;
-  int rside_posy;
-  int rside_width;
-  int rside_height;
-
-  int bside_posx;
-  int bside_posy;
-  int bside_width;
-  int bside_height;
+  int protocols;
+  // cached geometry indexed by LimeEventSrc, frame relative, see
+  // configure_client, the root relative frame geometry is kept in
+  // wm->geom_store at slot and geom[LIME_FRAME] is not used
+  int slot;
+  LimeGeometry geom[LIME_WINDOW + 1];
+  LimeGeometry drag_geom; // frame geometry when the drag started
+  unsigned long configure_serial; // last request sent by configure_client
 
   int drag_src_posx;
   int drag_src_posy;
@@ -48,20 +97,93 @@ typedef struct lime_client {
   int on_left_resize;
   int on_right_resize;
   int on_bottom_resize;
+
+  int motion_pending;
+  int pending_x_root;
+  int pending_y_root;
+
+  LimeEventSrc hover_src;
 } LimeClient;
 
-typedef struct lime_window_manager {
+// decoration windows of an unused frame, kept for reuse by frame()
+typedef struct lime_frame_set {
+  Window frame;
+  Window title;
+  Window downSide;
+  Window leftSide;
+  Window rightSide;
+} LimeFrameSet;
+
+#define LIME_FRAME_POOL_SIZE 16
+
+typedef struct lime_window_manager LimeWM;
+
+typedef void (*LimeSourceFunc)(LimeWM *wm, int fd, uint32_t events,
+                               void *udata);
+
+// a file descriptor multiplexed by the main loop next to the X connection
+typedef struct lime_source {
+  int fd;
+  uint32_t events;
+  LimeSourceFunc func;
+  void *udata;
+} LimeSource;
+
+// X traffic caused by one handler, see dispatch_event
+typedef struct lime_handler_cost {
+  uint64_t calls;
+  uint64_t requests; // requests issued, from the display sequence number
+  uint64_t round_trips; // replies the handler blocked on, annotated sites
+  uint64_t max_requests;
+  uint64_t max_round_trips;
+} LimeHandlerCost;
+
+struct lime_window_manager {
   Window main_window;
   Display *main_display;
-  LimeList *clients;
+  LimeLink clients; // LimeClient.link, most recently framed first
+  LimeLink focus_ring; // LimeClient.focus_link, most recently focused first
+  LimeClient *cycle_client; // Alt+Tab selection while Alt is held
+  LimeSlabCache *client_cache; // every LimeClient lives here
+  LimeGeomStore *geom_store; // frame geometry of every client, by slot
+  LimeSpatial *spatial; // frames by position and stacking, see client_at
+  LimeSnap snap; // edges the frame being dragged snaps to
+  LimePlace place; // finds the least covered spot for new frames
+  LimeGeometry *monitors; // root relative, the primary monitor first
+  int monitor_count;
+  LimeTile tile; // tiling layout over the primary monitor
+  LimeMap *windows; // every window lime cares about -> client + event src
   int sdragx;
   int sdragy;
   int framex;
   int framey;
   int framew;
   int frameh;
+  LimeClient *grab_client; // client being dragged or resized, if any
+  uint64_t motion_coalesced; // MotionNotify events dropped while grabbed
+  LimeMoveMode move_mode;
+  int pace_fd; // timerfd ticking once per refresh during paced drags
+  int pace_armed;
+  long pace_interval_ns;
+  LimeDecorMode decor_mode;
+  GC decor_gc;
+  LimeFrameSet frame_pool[LIME_FRAME_POOL_SIZE];
+  int frame_pool_count;
+  uint64_t frame_pool_hits;
+  uint64_t frame_pool_misses;
+  int epoll_fd;
+  int signal_fd;
+  LimeList *sources;
+  Atom atoms[LIME_ATOM_COUNT];
+  KeyCode keycodes[LIME_KEY_COUNT];
+  Cursor cursors[LIME_CURSOR_COUNT];
+  uint64_t round_trips; // synchronous replies waited for, see dispatch_event
+  LimeHandlerCost handler_costs[LIME_HANDLER_COUNT];
+#ifdef LIME_HISTOGRAM
+  LimeHistogram *latency; // handler time in ns, indexed by event type
+#endif
   int exit;
-} LimeWM;
+};
 
 LimeWM *lime_window_manager_create();
 
@@ -69,8 +191,49 @@ int lime_window_manager_init(LimeWM *wm);
 
 void lime_window_manager_run(LimeWM *wm);
 
+/*
+ * drive the handlers with an event stream saved through LIME_RECORD instead
+ * of live input, recorded windows are replaced by synthetic ones, the
+ * handler time per event type is printed to stderr, LIME_REPLAY_FAST=1
+ * ignores the recorded timing
+ */
+int lime_window_manager_replay(LimeWM *wm, const char *path);
+
 void lime_window_manager_exit(LimeWM *wm);
 
+// print the cached geometry of every client to stderr, also bound to SIGUSR2
+void lime_window_manager_dump_geometry(LimeWM *wm);
+
+/*
+ * print count, p50, p99 and max handler time per event type to stderr and
+ * the log, bound to SIGUSR1 and run at exit, needs -DLIME_HISTOGRAM=ON
+ */
+void lime_window_manager_dump_latency(LimeWM *wm);
+
+/*
+ * print requests and blocking replies per handler, worst first, and the
+ * call sites the replies were waited for at, bound to SIGUSR1 and run at exit,
+ * requests come from the sequence number and are complete, replies are only
+ * counted at the call sites annotated with LIME_ROUND_TRIPS
+ */
+void lime_window_manager_dump_round_trips(LimeWM *wm);
+
+/*
+ * watch fd with the given epoll events, func is called from
+ * lime_window_manager_run when it becomes ready
+ */
+int lime_window_manager_add_source(LimeWM *wm, int fd, uint32_t events,
+                                   LimeSourceFunc func, void *udata);
+
+void lime_window_manager_remove_source(LimeWM *wm, int fd);
+
+/*
+ * periodic timer source, returns the timerfd, the caller has to read it in
+ * func, remove it with lime_window_manager_remove_source and close it
+ */
+int lime_window_manager_add_timer(LimeWM *wm, long interval_ms,
+                                  LimeSourceFunc func, void *udata);
+
 void lime_window_manager_destroy(LimeWM *wm);
 
 #endif
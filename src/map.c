@@ -0,0 +1,127 @@
+#include "map.h"
+#include "mem.h"
+
+#define LIME_MAP_INIT_CAPACITY 64
+
+static size_t lime_map_hash(unsigned long w_id, size_t mask)
+{
+	// XIDs are allocated sequentially per client, mix the bits so that
+	// neighbouring windows do not land in neighbouring slots
+	uint64_t h = w_id;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h & mask;
+}
+
+LimeMap *lime_map_create()
+{
+	LimeMap *map = lime_mallocz(sizeof(*map));
+	map->capacity = LIME_MAP_INIT_CAPACITY;
+	map->entries = lime_mallocz(sizeof(*map->entries) * map->capacity);
+	return map;
+}
+
+static void lime_map_grow(LimeMap *map)
+{
+	LimeMapEntry *old = map->entries;
+	size_t old_capacity = map->capacity;
+
+	map->capacity = old_capacity * 2;
+	map->entries = lime_mallocz(sizeof(*map->entries) * map->capacity);
+	map->count = 0;
+	for (size_t i = 0; i < old_capacity; i++)
+	{
+		if (old[i].w_id != 0)
+		{
+			lime_map_put(map, old[i].w_id, old[i].data, old[i].tag);
+		}
+	}
+	lime_free(old);
+}
+
+int lime_map_put(LimeMap *map, unsigned long w_id, void *data, int tag)
+{
+	if (w_id == 0)
+	{
+		return -1;
+	}
+	// keep load factor under 0.75
+	if ((map->count + 1) * 4 > map->capacity * 3)
+	{
+		lime_map_grow(map);
+	}
+	size_t mask = map->capacity - 1;
+	size_t i = lime_map_hash(w_id, mask);
+	while (map->entries[i].w_id != 0 && map->entries[i].w_id != w_id)
+	{
+		i = (i + 1) & mask;
+	}
+	if (map->entries[i].w_id == 0)
+	{
+		map->count++;
+	}
+	map->entries[i].w_id = w_id;
+	map->entries[i].data = data;
+	map->entries[i].tag = tag;
+	return 0;
+}
+
+LimeMapEntry *lime_map_get(LimeMap *map, unsigned long w_id)
+{
+	if (w_id == 0)
+	{
+		return NULL;
+	}
+	size_t mask = map->capacity - 1;
+	size_t i = lime_map_hash(w_id, mask);
+	while (map->entries[i].w_id != 0)
+	{
+		if (map->entries[i].w_id == w_id)
+		{
+			return &map->entries[i];
+		}
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+void lime_map_del(LimeMap *map, unsigned long w_id)
+{
+	LimeMapEntry *entry = lime_map_get(map, w_id);
+	if (entry == NULL)
+	{
+		return;
+	}
+	size_t mask = map->capacity - 1;
+	size_t hole = entry - map->entries;
+	size_t i = hole;
+	// backward shift: move every following entry of the cluster that may
+	// legally live in the hole, so probing never needs tombstones
+	for (;;)
+	{
+		i = (i + 1) & mask;
+		if (map->entries[i].w_id == 0)
+		{
+			break;
+		}
+		size_t home = lime_map_hash(map->entries[i].w_id, mask);
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			map->entries[hole] = map->entries[i];
+			hole = i;
+		}
+	}
+	memset(&map->entries[hole], 0, sizeof(map->entries[hole]));
+	map->count--;
+}
+
+void lime_map_destory(LimeMap *map)
+{
+	if (!map)
+	{
+		return;
+	}
+	lime_free(map->entries);
+	lime_free(map);
+}
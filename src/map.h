@@ -1,15 +1,35 @@
 #ifndef __LIME_MAP_H__
 #define __LIME_MAP_H__
 
+#include "config.h"
+
+/*
+ * open addressing hash map keyed by X resource id (Window), linear probing,
+ * key 0 (None) marks an empty slot, deletion uses backward shift so there
+ * are no tombstones
+ */
 typedef struct lime_map_entry
 {
-	int w_id;
+	unsigned long w_id;
 	void *data;
+	int tag;
 } LimeMapEntry;
 
 typedef struct lime_map
 {
-	/* data */
+	LimeMapEntry *entries;
+	size_t capacity;
+	size_t count;
 } LimeMap;
 
-#endif
\ No newline at end of file
+LimeMap *lime_map_create();
+
+int lime_map_put(LimeMap *map, unsigned long w_id, void *data, int tag);
+
+LimeMapEntry *lime_map_get(LimeMap *map, unsigned long w_id);
+
+void lime_map_del(LimeMap *map, unsigned long w_id);
+
+void lime_map_destory(LimeMap *map);
+
+#endif
@@ -1,23 +1,264 @@
 #include "mem.h"
 
-static int64_t mem_count = 0;
-void *lime_malloc(size_t size)
+#define LIME_SLAB_PAGE 4096
+#define LIME_SLAB_ALIGN 16
+#define LIME_SLAB_MIN_OBJECTS 8
+
+static LimeSlabCache *slab_caches = NULL;
+
+/*
+ * the header keeps the user pointer 16 byte aligned, like malloc's, the
+ * size is needed to undo the accounting in lime_free
+ */
+typedef struct lime_mem_header
+{
+	LimeMemTag *tag;
+	size_t size;
+} LimeMemHeader;
+
+static _Atomic(LimeMemTag *) mem_tags = NULL;
+static atomic_size_t mem_live_bytes;
+static atomic_size_t mem_live_objects;
+static atomic_size_t mem_high_water_bytes;
+// slabs bypass the headers, they are counted on their own
+static atomic_size_t mem_slab_pages;
+static atomic_size_t mem_slab_bytes;
+
+static void lime_mem_raise(atomic_size_t *mark, size_t value)
+{
+	size_t seen = atomic_load_explicit(mark, memory_order_relaxed);
+	while (value > seen &&
+	       !atomic_compare_exchange_weak_explicit(mark, &seen, value, memory_order_relaxed,
+						      memory_order_relaxed))
+	{
+	}
+}
+
+static void lime_mem_register(LimeMemTag *tag)
+{
+	int expected = 0;
+	if (!atomic_compare_exchange_strong(&tag->registered, &expected, 1))
+	{
+		return;
+	}
+	LimeMemTag *head = atomic_load(&mem_tags);
+	do
+	{
+		tag->next = head;
+	} while (!atomic_compare_exchange_weak(&mem_tags, &head, tag));
+}
+
+static void *lime_mem_account(LimeMemHeader *header, size_t size, LimeMemTag *tag)
+{
+	if (header == NULL)
+	{
+		return NULL;
+	}
+	if (!atomic_load_explicit(&tag->registered, memory_order_relaxed))
+	{
+		lime_mem_register(tag);
+	}
+	header->tag = tag;
+	header->size = size;
+	size_t live = atomic_fetch_add_explicit(&tag->live_bytes, size, memory_order_relaxed) + size;
+	lime_mem_raise(&tag->high_water_bytes, live);
+	atomic_fetch_add_explicit(&tag->live_objects, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&tag->allocs, 1, memory_order_relaxed);
+
+	live = atomic_fetch_add_explicit(&mem_live_bytes, size, memory_order_relaxed) + size;
+	lime_mem_raise(&mem_high_water_bytes, live);
+	atomic_fetch_add_explicit(&mem_live_objects, 1, memory_order_relaxed);
+	return header + 1;
+}
+
+void *lime_malloc_tagged(size_t size, LimeMemTag *tag)
 {
-	mem_count++;
-	void *data = malloc(size);
-	return data;
+	LimeMemHeader *header = malloc(sizeof(*header) + size);
+	return lime_mem_account(header, size, tag);
 }
 
-void *lime_mallocz(size_t size)
+void *lime_mallocz_tagged(size_t size, LimeMemTag *tag)
 {
-	mem_count++;
-	void *data = malloc(size);
-	memset(data, 0, size);
-	return data;
+	LimeMemHeader *header = calloc(1, sizeof(*header) + size);
+	return lime_mem_account(header, size, tag);
 }
 
 void lime_free(void *data)
 {
-	mem_count--;
-	free(data);
-}
\ No newline at end of file
+	if (data == NULL)
+	{
+		return;
+	}
+	LimeMemHeader *header = (LimeMemHeader *)data - 1;
+	LimeMemTag *tag = header->tag;
+	atomic_fetch_sub_explicit(&tag->live_bytes, header->size, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&tag->live_objects, 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&mem_live_bytes, header->size, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&mem_live_objects, 1, memory_order_relaxed);
+	free(header);
+}
+
+size_t lime_mem_live_bytes() { return atomic_load(&mem_live_bytes); }
+
+size_t lime_mem_live_objects() { return atomic_load(&mem_live_objects); }
+
+void lime_mem_report(FILE *file)
+{
+	fprintf(file, "memory: %zu bytes in %zu objects live, high water %zu bytes\n",
+		lime_mem_live_bytes(), lime_mem_live_objects(), atomic_load(&mem_high_water_bytes));
+	for (LimeMemTag *tag = atomic_load(&mem_tags); tag != NULL; tag = tag->next)
+	{
+		size_t objects = atomic_load(&tag->live_objects);
+		if (objects == 0)
+		{
+			continue;
+		}
+		fprintf(file, "  %s:%d %zu bytes in %zu objects live, high water %zu bytes, %zu allocations\n",
+			tag->file, tag->line, atomic_load(&tag->live_bytes), objects,
+			atomic_load(&tag->high_water_bytes), atomic_load(&tag->allocs));
+	}
+	size_t pages = atomic_load(&mem_slab_pages);
+	if (pages)
+	{
+		fprintf(file, "  slabs: %zu bytes in %zu pages live\n", atomic_load(&mem_slab_bytes), pages);
+	}
+}
+
+// objects start after the slab header, on their own alignment
+static size_t lime_slab_header_size()
+{
+	return (sizeof(LimeSlab) + LIME_SLAB_ALIGN - 1) & ~(size_t)(LIME_SLAB_ALIGN - 1);
+}
+
+LimeSlabCache *lime_slab_cache_create(const char *name, size_t object_size)
+{
+	LimeSlabCache *cache = lime_mallocz(sizeof(*cache));
+	lime_slab_cache_init(cache, name, object_size);
+	return cache;
+}
+
+void lime_slab_cache_init(LimeSlabCache *cache, const char *name, size_t object_size)
+{
+	memset(cache, 0, sizeof(*cache));
+	if (object_size < sizeof(void *))
+	{
+		object_size = sizeof(void *);
+	}
+	cache->name = name;
+	cache->object_size = (object_size + LIME_SLAB_ALIGN - 1) & ~(size_t)(LIME_SLAB_ALIGN - 1);
+
+	// whole pages, big enough for a handful of objects
+	size_t need = lime_slab_header_size() + cache->object_size * LIME_SLAB_MIN_OBJECTS;
+	cache->slab_size = LIME_SLAB_PAGE;
+	while (cache->slab_size < need)
+	{
+		cache->slab_size += LIME_SLAB_PAGE;
+	}
+	cache->slab_objects = (cache->slab_size - lime_slab_header_size()) / cache->object_size;
+
+	cache->next = slab_caches;
+	slab_caches = cache;
+}
+
+static int lime_slab_grow(LimeSlabCache *cache)
+{
+	void *memory = NULL;
+	if (posix_memalign(&memory, LIME_SLAB_PAGE, cache->slab_size) != 0)
+	{
+		return -1;
+	}
+	atomic_fetch_add_explicit(&mem_slab_pages, cache->slab_size / LIME_SLAB_PAGE, memory_order_relaxed);
+	atomic_fetch_add_explicit(&mem_slab_bytes, cache->slab_size, memory_order_relaxed);
+	LimeSlab *slab = memory;
+	slab->next = cache->slabs;
+	cache->slabs = slab;
+	cache->slab_count++;
+
+	// thread the slots in address order so consecutive allocations are
+	// adjacent in memory
+	char *base = (char *)memory + lime_slab_header_size();
+	for (size_t i = cache->slab_objects; i > 0; i--)
+	{
+		void **slot = (void **)(base + (i - 1) * cache->object_size);
+		*slot = cache->free_list;
+		cache->free_list = slot;
+	}
+	return 0;
+}
+
+void *lime_slab_alloc(LimeSlabCache *cache)
+{
+	if (cache->free_list == NULL && lime_slab_grow(cache) < 0)
+	{
+		return NULL;
+	}
+	void **slot = cache->free_list;
+	cache->free_list = *slot;
+	cache->in_use++;
+	if (cache->in_use > cache->high_water)
+	{
+		cache->high_water = cache->in_use;
+	}
+	memset(slot, 0, cache->object_size);
+	return slot;
+}
+
+void lime_slab_free(LimeSlabCache *cache, void *object)
+{
+	if (object == NULL)
+	{
+		return;
+	}
+	void **slot = object;
+	*slot = cache->free_list;
+	cache->free_list = slot;
+	cache->in_use--;
+}
+
+void lime_slab_cache_release(LimeSlabCache *cache)
+{
+	for (LimeSlabCache **p = &slab_caches; *p != NULL; p = &(*p)->next)
+	{
+		if (*p == cache)
+		{
+			*p = cache->next;
+			break;
+		}
+	}
+	LimeSlab *slab = cache->slabs;
+	while (slab != NULL)
+	{
+		LimeSlab *next = slab->next;
+		free(slab);
+		atomic_fetch_sub_explicit(&mem_slab_pages, cache->slab_size / LIME_SLAB_PAGE, memory_order_relaxed);
+		atomic_fetch_sub_explicit(&mem_slab_bytes, cache->slab_size, memory_order_relaxed);
+		slab = next;
+	}
+	cache->slabs = NULL;
+	cache->free_list = NULL;
+	cache->slab_count = 0;
+	cache->in_use = 0;
+}
+
+void lime_slab_cache_destory(LimeSlabCache *cache)
+{
+	if (!cache)
+	{
+		return;
+	}
+	lime_slab_cache_release(cache);
+	lime_free(cache);
+}
+
+void lime_slab_dump_stats(FILE *file)
+{
+	fprintf(file, "%-16s %6s %6s %8s %8s %8s %6s\n", "slab cache", "size",
+		"slabs", "in use", "slots", "peak", "used");
+	for (LimeSlabCache *cache = slab_caches; cache != NULL; cache = cache->next)
+	{
+		size_t slots = cache->slab_count * cache->slab_objects;
+		fprintf(file, "%-16s %6zu %6zu %8zu %8zu %8zu %5.1f%%\n", cache->name,
+			cache->object_size, cache->slab_count, cache->in_use, slots,
+			cache->high_water, slots ? cache->in_use * 100.0 / slots : 0.0);
+	}
+}
@@ -1,10 +1,90 @@
 #ifndef __LIME_MEM_H__
 #define __LIME_MEM_H__
 #include "config.h"
+#include <stdatomic.h>
 
-void *lime_malloc(size_t size);
+/*
+ * every allocation carries a small header pointing at the tag of the call
+ * site that made it, tags keep atomic live byte/object counts and high
+ * water marks so lime_mem_report can list what is still alive, by call site
+ */
+typedef struct lime_mem_tag
+{
+	const char *file;
+	int line;
+	atomic_int registered;
+	atomic_size_t live_bytes;
+	atomic_size_t live_objects;
+	atomic_size_t high_water_bytes;
+	atomic_size_t allocs;
+	struct lime_mem_tag *next;
+} LimeMemTag;
 
-void *lime_mallocz(size_t size);
+#define LIME_MEM_TAG_HERE()                                                      \
+	({                                                                       \
+		static LimeMemTag lime_mem_tag = {.file = __FILE__, .line = __LINE__}; \
+		&lime_mem_tag;                                                   \
+	})
+
+#define lime_malloc(size) lime_malloc_tagged((size), LIME_MEM_TAG_HERE())
+
+#define lime_mallocz(size) lime_mallocz_tagged((size), LIME_MEM_TAG_HERE())
+
+void *lime_malloc_tagged(size_t size, LimeMemTag *tag);
+
+void *lime_mallocz_tagged(size_t size, LimeMemTag *tag);
 
 void lime_free(void *data);
-#endif
\ No newline at end of file
+
+// live bytes and objects over all tags
+size_t lime_mem_live_bytes();
+
+size_t lime_mem_live_objects();
+
+// totals, high water marks, live slab pages and every call site with live
+// allocations
+void lime_mem_report(FILE *file);
+
+/*
+ * slab cache for objects of one type: memory comes in page aligned slabs
+ * carved into fixed size slots, free slots are kept on a singly linked free
+ * list so allocating and freeing is a pointer pop/push, slabs are kept
+ * until the cache is destoryed
+ */
+typedef struct lime_slab
+{
+	struct lime_slab *next;
+} LimeSlab;
+
+typedef struct lime_slab_cache
+{
+	const char *name;
+	size_t object_size;  // slot size, rounded up to the alignment
+	size_t slab_size;
+	size_t slab_objects; // slots per slab
+	LimeSlab *slabs;
+	void *free_list;
+	size_t slab_count;
+	size_t in_use;
+	size_t high_water;
+	struct lime_slab_cache *next; // all caches, for lime_slab_dump_stats
+} LimeSlabCache;
+
+LimeSlabCache *lime_slab_cache_create(const char *name, size_t object_size);
+
+// set up a cache living in static storage
+void lime_slab_cache_init(LimeSlabCache *cache, const char *name, size_t object_size);
+
+// zeroed object, NULL when no slab could be allocated
+void *lime_slab_alloc(LimeSlabCache *cache);
+
+void lime_slab_free(LimeSlabCache *cache, void *object);
+
+// give the slabs of a cache set up with lime_slab_cache_init back
+void lime_slab_cache_release(LimeSlabCache *cache);
+
+void lime_slab_cache_destory(LimeSlabCache *cache);
+
+// slabs, objects in use and occupancy of every cache to file
+void lime_slab_dump_stats(FILE *file);
+#endif
@@ -0,0 +1,127 @@
+#include "place.h"
+#include "mem.h"
+
+void lime_place_init(LimePlace *place, int cell_size) {
+  memset(place, 0, sizeof(*place));
+  place->cell_size = cell_size;
+}
+
+static int lime_place_clamp(int value, int lo, int hi) {
+  return value < lo ? lo : value > hi ? hi : value;
+}
+
+/*
+ * table[(r + 1) * stride + c + 1] ends up as the coverage summed over the
+ * cells [0, r] x [0, c], row and column 0 stay zero
+ */
+static void lime_place_build(LimePlace *place, const LimeGeomStore *store,
+                             int skip_slot, const LimeGeometry *monitor,
+                             int cols, int rows) {
+  int cell = place->cell_size;
+  int stride = cols + 2;
+  int *table = place->table;
+  memset(table, 0, sizeof(*table) * stride * (rows + 2));
+
+  // corners of every frame go into a difference array first
+  for (size_t slot = 0; slot < store->slots; slot++) {
+    if (!(store->flags[slot] & LIME_GEOM_USED) || (int)slot == skip_slot ||
+        store->width[slot] <= 0 || store->height[slot] <= 0) {
+      continue;
+    }
+    int x0 = store->x[slot] - monitor->x;
+    int y0 = store->y[slot] - monitor->y;
+    int x1 = x0 + store->width[slot];
+    int y1 = y0 + store->height[slot];
+    if (x1 <= 0 || y1 <= 0 || x0 >= monitor->width || y0 >= monitor->height) {
+      continue;
+    }
+    int c0 = lime_place_clamp(x0, 0, monitor->width) / cell;
+    int r0 = lime_place_clamp(y0, 0, monitor->height) / cell;
+    int c1 = (lime_place_clamp(x1, 0, monitor->width) + cell - 1) / cell;
+    int r1 = (lime_place_clamp(y1, 0, monitor->height) + cell - 1) / cell;
+    table[(r0 + 1) * stride + c0 + 1]++;
+    table[(r0 + 1) * stride + c1 + 1]--;
+    table[(r1 + 1) * stride + c0 + 1]--;
+    table[(r1 + 1) * stride + c1 + 1]++;
+  }
+
+  // the first prefix pass turns it into per cell coverage, the second into
+  // the summed-area table
+  for (int pass = 0; pass < 2; pass++) {
+    for (int r = 1; r <= rows; r++) {
+      int *row = &table[r * stride];
+      const int *above = row - stride;
+      for (int c = 1; c <= cols; c++) {
+        row[c] += row[c - 1] + above[c] - above[c - 1];
+      }
+    }
+  }
+}
+
+int lime_place_find(LimePlace *place, const LimeGeomStore *store, int skip_slot,
+                    const LimeGeometry *monitors, int monitor_count, int w,
+                    int h, int *x, int *y) {
+  if (place->cell_size <= 0) {
+    return -1;
+  }
+  int cell = place->cell_size;
+  int best = -1;
+  for (int m = 0; m < monitor_count && best != 0; m++) {
+    const LimeGeometry *monitor = &monitors[m];
+    int cols = (monitor->width + cell - 1) / cell;
+    int rows = (monitor->height + cell - 1) / cell;
+    if (cols < 1 || rows < 1) {
+      continue;
+    }
+    size_t need = (size_t)(cols + 2) * (rows + 2);
+    if (need > place->capacity) {
+      lime_free(place->table);
+      place->table = lime_malloc(sizeof(*place->table) * need);
+      if (place->table == NULL) {
+        place->capacity = 0;
+        return -1;
+      }
+      place->capacity = need;
+    }
+    lime_place_build(place, store, skip_slot, monitor, cols, rows);
+
+    // a frame larger than the monitor is only tried at its top left
+    int span_c = lime_place_clamp((w + cell - 1) / cell, 1, cols);
+    int span_r = lime_place_clamp((h + cell - 1) / cell, 1, rows);
+    int stride = cols + 2;
+    const int *table = place->table;
+    for (int r = 0; r + span_r <= rows; r++) {
+      // top[c] sums the cells above row r, bottom[c] down to its last row
+      const int *top = &table[r * stride + 1];
+      const int *bottom = top + span_r * stride;
+      for (int c = 0; c + span_c <= cols; c++) {
+        int covered = bottom[c + span_c - 1] - bottom[c - 1] -
+                      top[c + span_c - 1] + top[c - 1];
+        if (best < 0 || covered < best) {
+          best = covered;
+          *x = monitor->x + c * cell;
+          *y = monitor->y + r * cell;
+          // cells round the frame up, keep it inside the monitor
+          if (*x + w > monitor->x + monitor->width) {
+            *x = lime_place_clamp(monitor->x + monitor->width - w, monitor->x,
+                                  *x);
+          }
+          if (*y + h > monitor->y + monitor->height) {
+            *y = lime_place_clamp(monitor->y + monitor->height - h,
+                                  monitor->y, *y);
+          }
+          if (best == 0) {
+            return 0;
+          }
+        }
+      }
+    }
+  }
+  return best;
+}
+
+void lime_place_release(LimePlace *place) {
+  lime_free(place->table);
+  place->table = NULL;
+  place->capacity = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef __LIME_PLACE_H__
+#define __LIME_PLACE_H__
+
+#include "config.h"
+#include "geometry.h"
+
+/*
+ * placement of new frames: the frames of the geometry store are rasterized
+ * into a coarse grid per monitor, counting how many frames cover each cell,
+ * a summed-area table over the grid then gives the coverage under any
+ * candidate position in O(1), so one placement is O(frames + cells)
+ */
+typedef struct lime_place {
+  int cell_size; // 0 disables placement
+  int *table;    // (rows + 2) * (cols + 2) summed-area table
+  size_t capacity;
+} LimePlace;
+
+void lime_place_init(LimePlace *place, int cell_size);
+
+/*
+ * least covered position for a w x h frame on any of the monitors, every
+ * used slot but skip_slot counts, ties go to the first monitor and then to
+ * the top left, returns the covered cells under the chosen position or -1
+ * when placement is disabled or out of memory
+ */
+int lime_place_find(LimePlace *place, const LimeGeomStore *store, int skip_slot,
+                    const LimeGeometry *monitors, int monitor_count, int w,
+                    int h, int *x, int *y);
+
+void lime_place_release(LimePlace *place);
+
+#endif
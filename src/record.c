@@ -0,0 +1,65 @@
+#include "record.h"
+#include "trace.h"
+
+int lime_record_enabled = 0;
+
+static FILE *lime_record_file = NULL;
+static uint64_t lime_record_start_ns = 0;
+
+int lime_record_open(const char *path) {
+  lime_record_file = fopen(path, "wb");
+  if (lime_record_file == NULL) {
+    return -1;
+  }
+  LimeRecordHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, LIME_RECORD_MAGIC, sizeof(header.magic));
+  header.version = LIME_RECORD_VERSION;
+  header.record_size = sizeof(LimeRecordEvent);
+  fwrite(&header, sizeof(header), 1, lime_record_file);
+  lime_record_start_ns = lime_trace_now();
+  lime_record_enabled = 1;
+  return 0;
+}
+
+void lime_record_write(LimeRecordEvent *record) {
+  if (!lime_record_enabled) {
+    return;
+  }
+  record->time_ns = lime_trace_now() - lime_record_start_ns;
+  // the display pointer is meaningless in another session
+  record->event.xany.display = NULL;
+  fwrite(record, sizeof(*record), 1, lime_record_file);
+}
+
+void lime_record_close() {
+  if (!lime_record_enabled) {
+    return;
+  }
+  fclose(lime_record_file);
+  lime_record_file = NULL;
+  lime_record_enabled = 0;
+}
+
+FILE *lime_record_open_read(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  LimeRecordHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, LIME_RECORD_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != LIME_RECORD_VERSION ||
+      header.record_size != sizeof(LimeRecordEvent)) {
+    fclose(file);
+    return NULL;
+  }
+  return file;
+}
+
+int lime_record_read(FILE *file, LimeRecordEvent *record) {
+  if (fread(record, sizeof(*record), 1, file) != 1) {
+    return -1;
+  }
+  return 0;
+}
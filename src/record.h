@@ -0,0 +1,59 @@
+#ifndef __LIME_RECORD_H__
+#define __LIME_RECORD_H__
+
+#include "config.h"
+#include <X11/Xlib.h>
+
+/*
+ * recording of the XEvent stream lime dispatched, replayed offline by
+ * lime_window_manager_replay, events are stored raw so a recording only
+ * replays on the architecture it was made on
+ */
+
+#define LIME_RECORD_MAGIC "LIMEREC1"
+#define LIME_RECORD_VERSION 1
+
+// src of a reference that is not a client window or one of its decorations
+#define LIME_RECORD_ROOT -1
+#define LIME_RECORD_NONE -2
+
+typedef struct lime_record_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+} LimeRecordHeader;
+
+/*
+ * window ids do not survive a replay, every window an event refers to is
+ * stored as the client window that owns it plus the LimeEventSrc it plays
+ * for that client
+ */
+typedef struct lime_record_ref {
+  uint64_t client;
+  int32_t src;
+  uint32_t pad;
+} LimeRecordRef;
+
+typedef struct lime_record_event {
+  uint64_t time_ns; // relative to the start of the recording
+  LimeRecordRef window;  // e.xany.window
+  LimeRecordRef subject; // the window the event is about, if different
+  XEvent event;
+} LimeRecordEvent;
+
+extern int lime_record_enabled;
+
+int lime_record_open(const char *path);
+
+// stamps the record with the time since lime_record_open
+void lime_record_write(LimeRecordEvent *record);
+
+void lime_record_close();
+
+// returns NULL when path is missing or not a recording
+FILE *lime_record_open_read(const char *path);
+
+// 0 on success, -1 at the end of the recording
+int lime_record_read(FILE *file, LimeRecordEvent *record);
+
+#endif
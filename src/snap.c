@@ -0,0 +1,143 @@
+#include "snap.h"
+#include "mem.h"
+#include <limits.h>
+
+void lime_snap_init(LimeSnap *snap, int threshold, int resist) {
+  memset(snap, 0, sizeof(*snap));
+  snap->threshold = threshold;
+  snap->resist = resist;
+}
+
+static int lime_snap_compare(const void *a, const void *b) {
+  const LimeSnapEdge *x = a;
+  const LimeSnapEdge *y = b;
+  return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+static void lime_snap_edge(LimeSnapEdge *edge, int pos, int lo, int hi) {
+  edge->pos = pos;
+  edge->lo = lo;
+  edge->hi = hi;
+}
+
+int lime_snap_begin(LimeSnap *snap, const LimeGeomStore *store, int skip_slot,
+                    const LimeGeometry *screen) {
+  snap->count = 0;
+  snap->screen = *screen;
+  // the screen edges are checked without collecting anything
+  if (snap->threshold <= 0) {
+    return 0;
+  }
+  int need = 2 * (int)store->slots;
+  if (need > snap->capacity) {
+    lime_free(snap->vertical);
+    lime_free(snap->horizontal);
+    snap->vertical = lime_malloc(sizeof(*snap->vertical) * need);
+    snap->horizontal = lime_malloc(sizeof(*snap->horizontal) * need);
+    snap->capacity = need;
+    if (snap->vertical == NULL || snap->horizontal == NULL) {
+      lime_snap_release(snap);
+      return -1;
+    }
+  }
+
+  LimeSnapEdge *v = snap->vertical;
+  LimeSnapEdge *h = snap->horizontal;
+  int n = 0;
+  for (size_t slot = 0; slot < store->slots; slot++) {
+    if (!(store->flags[slot] & LIME_GEOM_USED) || (int)slot == skip_slot ||
+        store->width[slot] <= 0 || store->height[slot] <= 0) {
+      continue;
+    }
+    int x = store->x[slot], y = store->y[slot];
+    int right = x + store->width[slot], bottom = y + store->height[slot];
+    lime_snap_edge(&v[n], x, y, bottom);
+    lime_snap_edge(&h[n++], y, x, right);
+    lime_snap_edge(&v[n], right, y, bottom);
+    lime_snap_edge(&h[n++], bottom, x, right);
+  }
+  qsort(v, n, sizeof(*v), lime_snap_compare);
+  qsort(h, n, sizeof(*h), lime_snap_compare);
+  snap->count = n;
+  return 0;
+}
+
+// first edge with pos >= value
+static int lime_snap_lower_bound(const LimeSnapEdge *edges, int count,
+                                 int value) {
+  int lo = 0, hi = count;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (edges[mid].pos < value) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static void lime_snap_consider(int delta, int threshold, int min_delta,
+                               int *best, int *found) {
+  if (abs(delta) <= threshold && delta >= min_delta &&
+      (!*found || abs(delta) < abs(*best))) {
+    *best = delta;
+    *found = 1;
+  }
+}
+
+// smallest correction moving value onto a frame edge whose extent meets
+// [lo, hi]
+static void lime_snap_nearest(const LimeSnap *snap, const LimeSnapEdge *edges,
+                              int value, int lo, int hi, int min_delta,
+                              int *best, int *found) {
+  for (int i = lime_snap_lower_bound(edges, snap->count,
+                                     value - snap->threshold);
+       i < snap->count && edges[i].pos <= value + snap->threshold; i++) {
+    if (edges[i].hi >= lo && edges[i].lo <= hi) {
+      lime_snap_consider(edges[i].pos - value, snap->threshold, min_delta,
+                         best, found);
+    }
+  }
+}
+
+/*
+ * both sides of the frame are tried against the frames and the screen edges
+ * start and end, each only while its threshold is on, corrections below
+ * min_delta are not taken
+ */
+static void lime_snap_axis(const LimeSnap *snap, const LimeSnapEdge *edges,
+                           int start, int end, int min_delta, int *pos,
+                           int size, int lo, int hi) {
+  int best = 0, found = 0;
+  if (snap->threshold > 0) {
+    lime_snap_nearest(snap, edges, *pos, lo, hi, min_delta, &best, &found);
+    lime_snap_nearest(snap, edges, *pos + size, lo, hi, min_delta, &best,
+                      &found);
+  }
+  if (snap->resist > 0) {
+    lime_snap_consider(start - *pos, snap->resist, min_delta, &best, &found);
+    lime_snap_consider(end - (*pos + size), snap->resist, min_delta, &best,
+                       &found);
+  }
+  if (found) {
+    *pos += best;
+  }
+}
+
+void lime_snap_apply(const LimeSnap *snap, int *x, int *y, int w, int h) {
+  const LimeGeometry *screen = &snap->screen;
+  lime_snap_axis(snap, snap->vertical, screen->x, screen->x + screen->width,
+                 INT_MIN, x, w, *y, *y + h);
+  lime_snap_axis(snap, snap->horizontal, screen->y, screen->y + screen->height,
+                 screen->y - *y, y, h, *x, *x + w);
+}
+
+void lime_snap_release(LimeSnap *snap) {
+  lime_free(snap->vertical);
+  lime_free(snap->horizontal);
+  snap->vertical = NULL;
+  snap->horizontal = NULL;
+  snap->count = 0;
+  snap->capacity = 0;
+}
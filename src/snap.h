@@ -0,0 +1,43 @@
+#ifndef __LIME_SNAP_H__
+#define __LIME_SNAP_H__
+
+#include "config.h"
+#include "geometry.h"
+
+/*
+ * edge snapping for frame drags: when a drag starts the edges of every other
+ * frame are collected into two lists sorted by position, each motion step
+ * then finds the edges near the moving frame by binary search, O(log n) plus
+ * the few edges inside the threshold, the screen edges are checked directly
+ */
+typedef struct lime_snap_edge {
+  int pos; // x of a vertical edge, y of a horizontal one
+  int lo;  // extent along the edge
+  int hi;
+} LimeSnapEdge;
+
+typedef struct lime_snap {
+  int threshold; // of the frame edges, 0 disables them
+  int resist;    // of the screen edges, 0 disables them
+  LimeGeometry screen; // frames stay below its top, see lime_snap_apply
+  LimeSnapEdge *vertical;
+  LimeSnapEdge *horizontal;
+  int count; // edges in each list
+  int capacity;
+} LimeSnap;
+
+void lime_snap_init(LimeSnap *snap, int threshold, int resist);
+
+// collect the edges of every used slot but skip_slot and of the screen
+int lime_snap_begin(LimeSnap *snap, const LimeGeomStore *store, int skip_slot,
+                    const LimeGeometry *screen);
+
+/*
+ * move x, y of a w x h frame onto the nearest edges within reach, edges that
+ * would put its top above the top of the screen are not snapped to
+ */
+void lime_snap_apply(const LimeSnap *snap, int *x, int *y, int w, int h);
+
+void lime_snap_release(LimeSnap *snap);
+
+#endif
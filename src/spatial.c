@@ -0,0 +1,199 @@
+#include "spatial.h"
+#include "mem.h"
+
+#define LIME_SPATIAL_CELL_INIT_CAPACITY 4
+
+LimeSpatial *lime_spatial_create(int width, int height, int cell_size) {
+  LimeSpatial *index = lime_mallocz(sizeof(*index));
+  index->cell_size = cell_size;
+  index->cols = (width + cell_size - 1) / cell_size;
+  index->rows = (height + cell_size - 1) / cell_size;
+  if (index->cols < 1) {
+    index->cols = 1;
+  }
+  if (index->rows < 1) {
+    index->rows = 1;
+  }
+  index->cells = lime_mallocz(sizeof(*index->cells) * index->cols * index->rows);
+  return index;
+}
+
+static int lime_spatial_reserve(LimeSpatial *index, int slot) {
+  if ((size_t)slot < index->capacity) {
+    return 0;
+  }
+  size_t capacity = index->capacity ? index->capacity : 64;
+  while (capacity <= (size_t)slot) {
+    capacity *= 2;
+  }
+  LimeSpatialSpan *spans = lime_malloc(sizeof(*spans) * capacity);
+  uint32_t *stack = lime_mallocz(sizeof(*stack) * capacity);
+  if (spans == NULL || stack == NULL) {
+    lime_free(spans);
+    lime_free(stack);
+    return -1;
+  }
+  if (index->capacity) {
+    memcpy(spans, index->spans, sizeof(*spans) * index->capacity);
+    memcpy(stack, index->stack, sizeof(*stack) * index->capacity);
+  }
+  for (size_t i = index->capacity; i < capacity; i++) {
+    spans[i].x0 = -1;
+  }
+  lime_free(index->spans);
+  lime_free(index->stack);
+  index->spans = spans;
+  index->stack = stack;
+  index->capacity = capacity;
+  return 0;
+}
+
+static int lime_spatial_clamp(int value, int max) {
+  if (value < 0) {
+    return 0;
+  }
+  return value > max ? max : value;
+}
+
+static LimeSpatialCell *lime_spatial_cell(const LimeSpatial *index, int cx,
+                                          int cy) {
+  return &index->cells[cy * index->cols + cx];
+}
+
+static int lime_spatial_cell_add(LimeSpatialCell *cell, int slot) {
+  if (cell->count == cell->capacity) {
+    int capacity =
+        cell->capacity ? cell->capacity * 2 : LIME_SPATIAL_CELL_INIT_CAPACITY;
+    int *slots = lime_malloc(sizeof(*slots) * capacity);
+    if (slots == NULL) {
+      return -1;
+    }
+    if (cell->count) {
+      memcpy(slots, cell->slots, sizeof(*slots) * cell->count);
+    }
+    lime_free(cell->slots);
+    cell->slots = slots;
+    cell->capacity = capacity;
+  }
+  cell->slots[cell->count++] = slot;
+  return 0;
+}
+
+static void lime_spatial_cell_del(LimeSpatialCell *cell, int slot) {
+  for (int i = 0; i < cell->count; i++) {
+    if (cell->slots[i] == slot) {
+      cell->slots[i] = cell->slots[--cell->count];
+      return;
+    }
+  }
+}
+
+static void lime_spatial_unlink(LimeSpatial *index, int slot) {
+  LimeSpatialSpan *span = &index->spans[slot];
+  if (span->x0 < 0) {
+    return;
+  }
+  for (int cy = span->y0; cy <= span->y1; cy++) {
+    for (int cx = span->x0; cx <= span->x1; cx++) {
+      lime_spatial_cell_del(lime_spatial_cell(index, cx, cy), slot);
+    }
+  }
+  span->x0 = -1;
+}
+
+int lime_spatial_update(LimeSpatial *index, const LimeGeomStore *store,
+                        int slot) {
+  if (lime_spatial_reserve(index, slot) < 0) {
+    return -1;
+  }
+  LimeSpatialSpan *span = &index->spans[slot];
+  int width = store->width[slot];
+  int height = store->height[slot];
+  if (width <= 0 || height <= 0) {
+    lime_spatial_unlink(index, slot);
+    return 0;
+  }
+  if (index->stack[slot] == 0) {
+    index->stack[slot] = ++index->top;
+  }
+
+  LimeSpatialSpan next;
+  next.x0 = lime_spatial_clamp(store->x[slot] / index->cell_size,
+                               index->cols - 1);
+  next.y0 = lime_spatial_clamp(store->y[slot] / index->cell_size,
+                               index->rows - 1);
+  next.x1 = lime_spatial_clamp((store->x[slot] + width - 1) / index->cell_size,
+                               index->cols - 1);
+  next.y1 = lime_spatial_clamp((store->y[slot] + height - 1) / index->cell_size,
+                               index->rows - 1);
+  // moves inside the same cells, most drag steps, cost nothing
+  if (span->x0 == next.x0 && span->y0 == next.y0 && span->x1 == next.x1 &&
+      span->y1 == next.y1) {
+    return 0;
+  }
+
+  lime_spatial_unlink(index, slot);
+  for (int cy = next.y0; cy <= next.y1; cy++) {
+    for (int cx = next.x0; cx <= next.x1; cx++) {
+      if (lime_spatial_cell_add(lime_spatial_cell(index, cx, cy), slot) < 0) {
+        // leave no half indexed slot behind
+        *span = next;
+        span->y1 = cy;
+        lime_spatial_unlink(index, slot);
+        return -1;
+      }
+    }
+  }
+  *span = next;
+  return 0;
+}
+
+void lime_spatial_remove(LimeSpatial *index, int slot) {
+  if (slot < 0 || (size_t)slot >= index->capacity) {
+    return;
+  }
+  lime_spatial_unlink(index, slot);
+  index->stack[slot] = 0;
+}
+
+void lime_spatial_raise(LimeSpatial *index, int slot) {
+  if (slot < 0 || (size_t)slot >= index->capacity) {
+    return;
+  }
+  index->stack[slot] = ++index->top;
+}
+
+int lime_spatial_query(const LimeSpatial *index, const LimeGeomStore *store,
+                       int x, int y) {
+  int cx = lime_spatial_clamp(x / index->cell_size, index->cols - 1);
+  int cy = lime_spatial_clamp(y / index->cell_size, index->rows - 1);
+  const LimeSpatialCell *cell = lime_spatial_cell(index, cx, cy);
+  int best = -1;
+  uint32_t best_stack = 0;
+  for (int i = 0; i < cell->count; i++) {
+    int slot = cell->slots[i];
+    if (x < store->x[slot] || y < store->y[slot] ||
+        x >= store->x[slot] + store->width[slot] ||
+        y >= store->y[slot] + store->height[slot]) {
+      continue;
+    }
+    if (index->stack[slot] > best_stack) {
+      best_stack = index->stack[slot];
+      best = slot;
+    }
+  }
+  return best;
+}
+
+void lime_spatial_destory(LimeSpatial *index) {
+  if (!index) {
+    return;
+  }
+  for (int i = 0; i < index->cols * index->rows; i++) {
+    lime_free(index->cells[i].slots);
+  }
+  lime_free(index->cells);
+  lime_free(index->spans);
+  lime_free(index->stack);
+  lime_free(index);
+}
@@ -0,0 +1,57 @@
+#ifndef __LIME_SPATIAL_H__
+#define __LIME_SPATIAL_H__
+
+#include "config.h"
+#include "geometry.h"
+
+/*
+ * uniform grid over the screen, each cell lists the geometry store slots
+ * whose frame overlaps it, a point query only looks at the frames of one
+ * cell and returns the one stacked highest, frames reaching past the screen
+ * are clamped to the border cells
+ */
+typedef struct lime_spatial_cell {
+  int *slots;
+  int count;
+  int capacity;
+} LimeSpatialCell;
+
+// cells covered by a slot, x0 is -1 when the slot is not indexed
+typedef struct lime_spatial_span {
+  int x0;
+  int y0;
+  int x1;
+  int y1;
+} LimeSpatialSpan;
+
+typedef struct lime_spatial {
+  int cell_size;
+  int cols;
+  int rows;
+  LimeSpatialCell *cells;
+  LimeSpatialSpan *spans; // by slot
+  uint32_t *stack;        // by slot, higher is above
+  size_t capacity;
+  uint32_t top;
+} LimeSpatial;
+
+LimeSpatial *lime_spatial_create(int width, int height, int cell_size);
+
+/*
+ * (re)index slot after its geometry in store changed, a slot seen for the
+ * first time goes on top of the stack, an empty rectangle unindexes it
+ */
+int lime_spatial_update(LimeSpatial *index, const LimeGeomStore *store,
+                        int slot);
+
+void lime_spatial_remove(LimeSpatial *index, int slot);
+
+void lime_spatial_raise(LimeSpatial *index, int slot);
+
+// topmost slot whose frame contains x, y (root coordinates), -1 for none
+int lime_spatial_query(const LimeSpatial *index, const LimeGeomStore *store,
+                       int x, int y);
+
+void lime_spatial_destory(LimeSpatial *index);
+
+#endif
@@ -0,0 +1,195 @@
+#include "tile.h"
+#include "mem.h"
+
+void lime_tile_init(LimeTile *tile, LimeTileMode mode, int columns,
+                    int min_size, const LimeGeometry *area) {
+  memset(tile, 0, sizeof(*tile));
+  tile->mode = mode;
+  tile->min_size = min_size < 1 ? 1 : min_size;
+  // no more columns than fit at min_size
+  int fit = area->width / tile->min_size;
+  if (columns > fit) {
+    columns = fit;
+  }
+  tile->columns = columns < 1                       ? 1
+                  : columns > LIME_TILE_MAX_COLUMNS ? LIME_TILE_MAX_COLUMNS
+                                                    : columns;
+  tile->area = *area;
+  for (int i = 0; i < LIME_TILE_MAX_COLUMNS; i++) {
+    lime_link_init(&tile->column[i].nodes);
+  }
+}
+
+void lime_tile_node_init(LimeTileNode *node, int slot) {
+  lime_link_init(&node->link);
+  node->slot = slot;
+  node->column = -1;
+}
+
+static void lime_tile_append(LimeTile *tile, LimeTileNode *node, int column) {
+  LimeTileColumn *col = &tile->column[column];
+  lime_link_add_tail(&col->nodes, &node->link);
+  node->column = column;
+  col->count++;
+  col->dirty = 1;
+}
+
+static void lime_tile_unlink(LimeTile *tile, LimeTileNode *node) {
+  LimeTileColumn *col = &tile->column[node->column];
+  lime_link_del(&node->link);
+  node->column = -1;
+  col->count--;
+  col->dirty = 1;
+}
+
+void lime_tile_insert(LimeTile *tile, LimeTileNode *node) {
+  if (node->column >= 0) {
+    return;
+  }
+  switch (tile->mode) {
+  case LIME_TILE_MASTER_STACK:
+    lime_tile_append(tile, node, tile->column[0].count == 0 ? 0 : 1);
+    break;
+  case LIME_TILE_COLUMNS: {
+    // the shortest column, the leftmost one on ties
+    int best = 0;
+    for (int i = 1; i < tile->columns; i++) {
+      if (tile->column[i].count < tile->column[best].count) {
+        best = i;
+      }
+    }
+    lime_tile_append(tile, node, best);
+  } break;
+  default:
+    break;
+  }
+}
+
+void lime_tile_remove(LimeTile *tile, LimeTileNode *node) {
+  if (node->column < 0) {
+    return;
+  }
+  int column = node->column;
+  lime_tile_unlink(tile, node);
+  // the oldest stacked node takes over an empty master column
+  if (tile->mode == LIME_TILE_MASTER_STACK && column == 0 &&
+      tile->column[1].count > 0) {
+    LimeTileNode *next =
+        lime_link_entry(tile->column[1].nodes.next, LimeTileNode, link);
+    lime_tile_unlink(tile, next);
+    lime_tile_append(tile, next, 0);
+  }
+}
+
+void lime_tile_clear(LimeTile *tile) {
+  for (int i = 0; i < LIME_TILE_MAX_COLUMNS; i++) {
+    LimeTileColumn *col = &tile->column[i];
+    while (!lime_link_empty(&col->nodes)) {
+      lime_tile_unlink(tile,
+                       lime_link_entry(col->nodes.next, LimeTileNode, link));
+    }
+  }
+}
+
+static int lime_tile_push(LimeTile *tile, int slot, const LimeGeometry *geom) {
+  if (tile->change_count == tile->change_capacity) {
+    int capacity = tile->change_capacity ? tile->change_capacity * 2 : 16;
+    LimeTileChange *changes = lime_malloc(sizeof(*changes) * capacity);
+    if (changes == NULL) {
+      return -1;
+    }
+    if (tile->change_count) {
+      memcpy(changes, tile->changes, sizeof(*changes) * tile->change_count);
+    }
+    lime_free(tile->changes);
+    tile->changes = changes;
+    tile->change_capacity = capacity;
+  }
+  tile->changes[tile->change_count].slot = slot;
+  tile->changes[tile->change_count].geom = *geom;
+  tile->change_count++;
+  return 0;
+}
+
+/*
+ * split the column x, width evenly into rows top to bottom, one node per
+ * row, the nodes that do not fit at min_size share the last row
+ */
+static int lime_tile_column(LimeTile *tile, LimeTileColumn *col,
+                            const LimeGeomStore *store, int x, int width) {
+  int rows = tile->area.height / tile->min_size;
+  if (rows > col->count) {
+    rows = col->count;
+  }
+  if (rows < 1) {
+    rows = 1;
+  }
+  int i = 0;
+  lime_link_for_each(pos, &col->nodes) {
+    LimeTileNode *node = lime_link_entry(pos, LimeTileNode, link);
+    int row = i < rows ? i : rows - 1;
+    int y = tile->area.y + tile->area.height * row / rows;
+    int bottom = tile->area.y + tile->area.height * (row + 1) / rows;
+    LimeGeometry geom = {x, y, width, bottom - y};
+    LimeGeometry cur = lime_geom_store_get(store, node->slot);
+    if ((cur.x != geom.x || cur.y != geom.y || cur.width != geom.width ||
+         cur.height != geom.height) &&
+        lime_tile_push(tile, node->slot, &geom) < 0) {
+      return -1;
+    }
+    i++;
+  }
+  col->dirty = 0;
+  return 0;
+}
+
+int lime_tile_layout(LimeTile *tile, const LimeGeomStore *store) {
+  tile->change_count = 0;
+  if (tile->mode == LIME_TILE_FLOATING) {
+    return 0;
+  }
+  int visible[LIME_TILE_MAX_COLUMNS];
+  int count = 0;
+  uint32_t mask = 0;
+  for (int i = 0; i < LIME_TILE_MAX_COLUMNS; i++) {
+    if (tile->column[i].count > 0) {
+      visible[count++] = i;
+      mask |= 1u << i;
+    }
+  }
+  int relayout_all = mask != tile->visible_mask;
+  tile->visible_mask = mask;
+
+  const LimeGeometry *area = &tile->area;
+  for (int v = 0; v < count; v++) {
+    LimeTileColumn *col = &tile->column[visible[v]];
+    if (!col->dirty && !relayout_all) {
+      continue;
+    }
+    int x, right;
+    if (tile->mode == LIME_TILE_MASTER_STACK && count == 2) {
+      int split = area->x + area->width * LIME_TILE_MASTER_PERCENT / 100;
+      x = v == 0 ? area->x : split;
+      right = v == 0 ? split : area->x + area->width;
+    } else {
+      x = area->x + area->width * v / count;
+      right = area->x + area->width * (v + 1) / count;
+    }
+    if (lime_tile_column(tile, col, store, x, right - x) < 0) {
+      return -1;
+    }
+  }
+  // emptied columns have nothing to lay out
+  for (int i = 0; i < LIME_TILE_MAX_COLUMNS; i++) {
+    tile->column[i].dirty = 0;
+  }
+  return tile->change_count;
+}
+
+void lime_tile_release(LimeTile *tile) {
+  lime_tile_clear(tile);
+  lime_free(tile->changes);
+  tile->changes = NULL;
+  tile->change_count = 0;
+  tile->change_capacity = 0;
+}
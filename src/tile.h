@@ -0,0 +1,76 @@
+#ifndef __LIME_TILE_H__
+#define __LIME_TILE_H__
+
+#include "config.h"
+#include "geometry.h"
+#include "list.h"
+
+#define LIME_TILE_MAX_COLUMNS 8
+#define LIME_TILE_MASTER_PERCENT 55
+
+typedef enum lime_tile_mode {
+  LIME_TILE_FLOATING,     // frames stay where they are put
+  LIME_TILE_MASTER_STACK, // oldest frame in the master column, rest stacked
+  LIME_TILE_COLUMNS,      // frames spread over equally wide columns
+  LIME_TILE_MODE_COUNT,
+} LimeTileMode;
+
+// lives inside the tiled object, see LimeClient.tile
+typedef struct lime_tile_node {
+  LimeLink link; // in its column, oldest first
+  int slot;      // geometry store slot the layout is written for
+  int column;    // -1 when not tiled
+} LimeTileNode;
+
+typedef struct lime_tile_column {
+  LimeLink nodes;
+  int count;
+  int dirty;
+} LimeTileColumn;
+
+typedef struct lime_tile_change {
+  int slot;
+  LimeGeometry geom;
+} LimeTileChange;
+
+/*
+ * tiling layout over one area, inserting or removing a node only marks the
+ * columns it touches dirty and lime_tile_layout recomputes just those, all
+ * columns are laid out again only when the set of non-empty columns changes
+ * because that changes their widths, a column holds as many rows as fit at
+ * min_size, the nodes beyond that are stacked on its last row
+ */
+typedef struct lime_tile {
+  LimeTileMode mode;
+  LimeGeometry area;
+  int min_size;          // smallest frame width and height a layout makes
+  int columns;           // columns used by LIME_TILE_COLUMNS
+  uint32_t visible_mask; // non-empty columns at the last layout pass
+  LimeTileColumn column[LIME_TILE_MAX_COLUMNS];
+  LimeTileChange *changes; // result of the last layout pass
+  int change_count;
+  int change_capacity;
+} LimeTile;
+
+void lime_tile_init(LimeTile *tile, LimeTileMode mode, int columns,
+                    int min_size, const LimeGeometry *area);
+
+void lime_tile_node_init(LimeTileNode *node, int slot);
+
+// append node to the column the mode picks for it, ignored when floating
+void lime_tile_insert(LimeTile *tile, LimeTileNode *node);
+
+void lime_tile_remove(LimeTile *tile, LimeTileNode *node);
+
+// untile every node, e.g. before switching the mode and inserting again
+void lime_tile_clear(LimeTile *tile);
+
+/*
+ * lay out the dirty columns, tile->changes gets the slots whose geometry in
+ * store differs from the layout, returns their count or -1 out of memory
+ */
+int lime_tile_layout(LimeTile *tile, const LimeGeomStore *store);
+
+void lime_tile_release(LimeTile *tile);
+
+#endif
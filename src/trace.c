@@ -0,0 +1,139 @@
+#include "trace.h"
+#include <time.h>
+
+#define LIME_TRACE_BUFFER_RECORDS 4096
+
+int lime_trace_enabled = 0;
+
+static FILE *lime_trace_file = NULL;
+static LimeTraceRecord lime_trace_buffer[LIME_TRACE_BUFFER_RECORDS];
+static size_t lime_trace_count = 0;
+
+static const char *const LIME_HANDLER_NAMES[LIME_HANDLER_COUNT] = {
+    [LIME_HANDLER_NONE] = "ignored",
+    [LIME_HANDLER_CREATE_NOTIFY] = "on_create_notify",
+    [LIME_HANDLER_DESTROY_NOTIFY] = "on_destroy_notify",
+    [LIME_HANDLER_REPARENT_NOTIFY] = "on_reparent_notify",
+    [LIME_HANDLER_CONFIGURE_REQUEST] = "on_configure_request",
+    [LIME_HANDLER_CONFIGURE_NOTIFY] = "on_configure_notify",
+    [LIME_HANDLER_MAP_REQUEST] = "on_map_request",
+    [LIME_HANDLER_MAP_NOTIFY] = "on_map_notify",
+    [LIME_HANDLER_UNMAP_NOTIFY] = "on_unmap_notify",
+    [LIME_HANDLER_BUTTON_PRESS] = "on_button_press",
+    [LIME_HANDLER_BUTTON_RELEASE] = "on_button_release",
+    [LIME_HANDLER_MOTION_NOTIFY] = "on_motion_notify",
+    [LIME_HANDLER_KEY_PRESS] = "on_key_press",
+    [LIME_HANDLER_KEY_RELEASE] = "on_key_release",
+    [LIME_HANDLER_FOCUS_IN] = "on_focus_in",
+    [LIME_HANDLER_FOCUS_OUT] = "on_focus_out",
+    [LIME_HANDLER_POINTER_ENTER] = "on_pointer_enter",
+    [LIME_HANDLER_POINTER_LEAVE] = "on_pointer_leave",
+    [LIME_HANDLER_EXPOSE] = "on_expose",
+    [LIME_HANDLER_MAPPING_NOTIFY] = "on_mapping_notify",
+    [LIME_HANDLER_PACE_TIMER] = "on_pace_timer",
+};
+
+static const char *const X_EVENT_TYPE_NAMES[] = {
+    "",
+    "",
+    "KeyPress",
+    "KeyRelease",
+    "ButtonPress",
+    "ButtonRelease",
+    "MotionNotify",
+    "EnterNotify",
+    "LeaveNotify",
+    "FocusIn",
+    "FocusOut",
+    "KeymapNotify",
+    "Expose",
+    "GraphicsExpose",
+    "NoExpose",
+    "VisibilityNotify",
+    "CreateNotify",
+    "DestroyNotify",
+    "UnmapNotify",
+    "MapNotify",
+    "MapRequest",
+    "ReparentNotify",
+    "ConfigureNotify",
+    "ConfigureRequest",
+    "GravityNotify",
+    "ResizeRequest",
+    "CirculateNotify",
+    "CirculateRequest",
+    "PropertyNotify",
+    "SelectionClear",
+    "SelectionRequest",
+    "SelectionNotify",
+    "ColormapNotify",
+    "ClientMessage",
+    "MappingNotify",
+    "GeneralEvent",
+};
+
+const char *lime_handler_name(int handler) {
+  if (handler < 0 || handler >= LIME_HANDLER_COUNT) {
+    return "unknown";
+  }
+  return LIME_HANDLER_NAMES[handler];
+}
+
+const char *lime_event_name(int type) {
+  if (type < 2 || type >= (int)(sizeof(X_EVENT_TYPE_NAMES) /
+                                 sizeof(X_EVENT_TYPE_NAMES[0]))) {
+    return NULL;
+  }
+  return X_EVENT_TYPE_NAMES[type];
+}
+
+uint64_t lime_trace_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int lime_trace_open(const char *path) {
+  lime_trace_file = fopen(path, "wb");
+  if (lime_trace_file == NULL) {
+    return -1;
+  }
+  LimeTraceHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, LIME_TRACE_MAGIC, sizeof(header.magic));
+  header.version = LIME_TRACE_VERSION;
+  header.record_size = sizeof(LimeTraceRecord);
+  header.start_ns = lime_trace_now();
+  fwrite(&header, sizeof(header), 1, lime_trace_file);
+  lime_trace_count = 0;
+  lime_trace_enabled = 1;
+  return 0;
+}
+
+static void lime_trace_flush() {
+  if (lime_trace_count > 0) {
+    fwrite(lime_trace_buffer, sizeof(LimeTraceRecord), lime_trace_count,
+           lime_trace_file);
+    lime_trace_count = 0;
+  }
+}
+
+void lime_trace_record(const LimeTraceRecord *record) {
+  if (!lime_trace_enabled) {
+    return;
+  }
+  lime_trace_buffer[lime_trace_count++] = *record;
+  if (lime_trace_count == LIME_TRACE_BUFFER_RECORDS) {
+    lime_trace_flush();
+  }
+}
+
+void lime_trace_close() {
+  if (!lime_trace_enabled) {
+    return;
+  }
+  lime_trace_flush();
+  fclose(lime_trace_file);
+  lime_trace_file = NULL;
+  lime_trace_enabled = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef __LIME_TRACE_H__
+#define __LIME_TRACE_H__
+
+#include "config.h"
+
+/*
+ * binary per-session trace of dispatched events, one fixed size record per
+ * handler call, converted to Chrome trace JSON by lime-trace2json
+ */
+
+#define LIME_TRACE_MAGIC "LIMETRC1"
+#define LIME_TRACE_VERSION 1
+
+// event type used for records that do not come from an XEvent
+#define LIME_TRACE_TIMER_EVENT 0
+
+typedef enum lime_handler {
+  LIME_HANDLER_NONE,
+  LIME_HANDLER_CREATE_NOTIFY,
+  LIME_HANDLER_DESTROY_NOTIFY,
+  LIME_HANDLER_REPARENT_NOTIFY,
+  LIME_HANDLER_CONFIGURE_REQUEST,
+  LIME_HANDLER_CONFIGURE_NOTIFY,
+  LIME_HANDLER_MAP_REQUEST,
+  LIME_HANDLER_MAP_NOTIFY,
+  LIME_HANDLER_UNMAP_NOTIFY,
+  LIME_HANDLER_BUTTON_PRESS,
+  LIME_HANDLER_BUTTON_RELEASE,
+  LIME_HANDLER_MOTION_NOTIFY,
+  LIME_HANDLER_KEY_PRESS,
+  LIME_HANDLER_KEY_RELEASE,
+  LIME_HANDLER_FOCUS_IN,
+  LIME_HANDLER_FOCUS_OUT,
+  LIME_HANDLER_POINTER_ENTER,
+  LIME_HANDLER_POINTER_LEAVE,
+  LIME_HANDLER_EXPOSE,
+  LIME_HANDLER_MAPPING_NOTIFY,
+  LIME_HANDLER_PACE_TIMER,
+  LIME_HANDLER_COUNT,
+} LimeHandler;
+
+typedef struct lime_trace_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t start_ns; // CLOCK_MONOTONIC when the trace was opened
+} LimeTraceHeader;
+
+typedef struct lime_trace_record {
+  uint64_t enter_ns;
+  uint64_t exit_ns;
+  uint32_t requests; // X requests issued by the handler
+  uint16_t event_type;
+  uint16_t handler;
+} LimeTraceRecord;
+
+extern int lime_trace_enabled;
+
+// name of a handler, "unknown" for ids not in LimeHandler
+const char *lime_handler_name(int handler);
+
+// name of an X event type, NULL when out of range
+const char *lime_event_name(int type);
+
+uint64_t lime_trace_now();
+
+// start writing records to path, returns -1 when it can not be created
+int lime_trace_open(const char *path);
+
+void lime_trace_record(const LimeTraceRecord *record);
+
+void lime_trace_close();
+
+#endif
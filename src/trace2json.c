@@ -0,0 +1,69 @@
+#include "trace.h"
+
+/*
+ * lime-trace2json: convert a binary trace written with LIME_TRACE=<file>
+ * into Chrome trace event JSON, loadable in chrome://tracing or Perfetto
+ */
+
+static const char *event_name(int type) {
+  if (type == LIME_TRACE_TIMER_EVENT) {
+    return "timer";
+  }
+  const char *name = lime_event_name(type);
+  return name ? name : "unknown";
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace file> [output json]\n", argv[0]);
+    return 1;
+  }
+  FILE *in = fopen(argv[1], "rb");
+  if (in == NULL) {
+    fprintf(stderr, "can not open %s\n", argv[1]);
+    return 1;
+  }
+  FILE *out = stdout;
+  if (argc > 2) {
+    out = fopen(argv[2], "w");
+    if (out == NULL) {
+      fprintf(stderr, "can not create %s\n", argv[2]);
+      fclose(in);
+      return 1;
+    }
+  }
+
+  LimeTraceHeader header;
+  if (fread(&header, sizeof(header), 1, in) != 1 ||
+      memcmp(header.magic, LIME_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != LIME_TRACE_VERSION ||
+      header.record_size != sizeof(LimeTraceRecord)) {
+    fprintf(stderr, "%s is not a lime trace\n", argv[1]);
+    fclose(in);
+    return 1;
+  }
+
+  fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  LimeTraceRecord record;
+  size_t count = 0;
+  while (fread(&record, sizeof(record), 1, in) == 1) {
+    double ts = (record.enter_ns - header.start_ns) / 1000.0;
+    double dur = (record.exit_ns - record.enter_ns) / 1000.0;
+    fprintf(out,
+            "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+            "\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"event\":\"%s\",\"requests\":%u}}\n",
+            count ? "," : "", lime_handler_name(record.handler),
+            event_name(record.event_type), ts, dur,
+            event_name(record.event_type), record.requests);
+    count++;
+  }
+  fprintf(out, "]}\n");
+
+  fclose(in);
+  if (out != stdout) {
+    fclose(out);
+  }
+  fprintf(stderr, "converted %zu records\n", count);
+  return 0;
+}